@@ -0,0 +1,575 @@
+#include "GraphGenerator.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include <assert.h>
+
+#include <algorithm>
+#include <set>
+
+static const char * TEXTURE_FORMATS [] = { "RGBA8", "RGBA16F", "R11F_G11F_B10F", "R32F" };
+
+static const char * UNARY_OPERATORS [] = { "negation", "absolute" };
+static const char * BINARY_OPERATORS [] = { "addition", "subtraction", "multiplication", "division" };
+
+/**
+ * @brief getGraphShapeName
+ * @param shape
+ * @return
+ */
+const char * getGraphShapeName(GraphShape shape)
+{
+	switch (shape)
+	{
+		case GraphShape::DEEP_CHAIN:		return("deep-chain");
+		case GraphShape::WIDE_DAG:			return("wide-dag");
+		case GraphShape::OPERATOR_HEAVY:	return("operator-heavy");
+		case GraphShape::PASS_PIPELINE:		return("pass-pipeline");
+	}
+
+	return("unknown");
+}
+
+/**
+ * @brief Constructor
+ * @param seed
+ */
+GraphGenerator::GraphGenerator(unsigned int seed) : m_seed(seed)
+{
+	// ...
+}
+
+/**
+ * @brief Generate a graph in the JSON Graph Format read by Graph::loadFromFile
+ * @param shape
+ * @param nodeCount approximate number of nodes (the generated graph is always valid, even when it does not fit)
+ * @return
+ */
+std::string GraphGenerator::generate(GraphShape shape, unsigned int nodeCount)
+{
+	m_nodes.clear();
+	m_edges.clear();
+	m_inputCounts.clear();
+
+	// the same graph for a given seed / shape / size, independently of what was generated before
+	m_random.seed(m_seed ^ (static_cast<unsigned int>(shape) << 24) ^ nodeCount);
+
+	switch (shape)
+	{
+		case GraphShape::DEEP_CHAIN:
+			generateDeepChain(nodeCount);
+			break;
+		case GraphShape::WIDE_DAG:
+			generateWideDAG(nodeCount);
+			break;
+		case GraphShape::OPERATOR_HEAVY:
+			generateOperatorHeavy(nodeCount);
+			break;
+		case GraphShape::PASS_PIPELINE:
+			generatePassPipeline(nodeCount);
+			break;
+	}
+
+	std::string json;
+	json.reserve(m_nodes.size() * 96 + m_edges.size() * 128);
+
+	json += "{\"graph\":{\"directed\":true,\"nodes\":[";
+
+	for (unsigned int i = 0; i < m_nodes.size(); ++i)
+	{
+		const NodeDesc & node = m_nodes[i];
+
+		json += (i > 0) ? ",\n" : "\n";
+		json += "{\"id\":\"" + node.id + "\",\"type\":\"" + node.type + "\",\"metadata\":{";
+
+		if (!node.key.empty())
+		{
+			json += "\"" + node.key + "\":\"" + node.value + "\"";
+		}
+
+		json += "}}";
+	}
+
+	json += "],\"edges\":[";
+
+	for (unsigned int i = 0; i < m_edges.size(); ++i)
+	{
+		const EdgeDesc & edge = m_edges[i];
+
+		json += (i > 0) ? ",\n" : "\n";
+		json += "{\"source\":\"" + edge.source + "\",\"target\":\"" + edge.target + "\",\"metadata\":{";
+		json += "\"source_id\":\"" + std::to_string(edge.source_id) + "\",\"target_id\":\"" + std::to_string(edge.target_id) + "\"}}";
+	}
+
+	json += "]}}\n";
+
+	return(json);
+}
+
+/**
+ * @brief Generate a graph and write it to a file
+ * @param shape
+ * @param nodeCount
+ * @param path
+ * @return
+ */
+bool GraphGenerator::generateToFile(GraphShape shape, unsigned int nodeCount, const char * path)
+{
+	std::string json = generate(shape, nodeCount);
+
+	FILE * file = fopen(path, "wb");
+
+	if (file == nullptr)
+	{
+		return(false);
+	}
+
+	bool success = (fwrite(json.data(), 1, json.size(), file) == json.size());
+
+	success = (fclose(file) == 0) && success;
+
+	return(success);
+}
+
+/**
+ * @brief One long chain of passes : stresses the depth of the topological sort and the liveness analysis
+ * @param nodeCount
+ */
+void GraphGenerator::generateDeepChain(unsigned int nodeCount)
+{
+	const std::string constant = addFloat();
+
+	std::string texture;
+
+	std::vector<std::string> inputs;
+	std::vector<std::string> textures;
+
+	while (texture.empty() || m_nodes.size() + 3 <= nodeCount) // pass + texture + present
+	{
+		inputs.clear();
+
+		if (!texture.empty())
+		{
+			inputs.push_back(texture);
+		}
+
+		if (random(4) == 0 && m_nodes.size() + 4 <= nodeCount)
+		{
+			inputs.push_back(addFloat());
+		}
+		else
+		{
+			inputs.push_back(constant);
+		}
+
+		addPass(inputs, 1, textures);
+		texture = textures[0];
+	}
+
+	addPresent(texture);
+}
+
+/**
+ * @brief Layers of independent passes reading random textures of the previous layer, then a pairwise reduction
+ * @param nodeCount
+ */
+void GraphGenerator::generateWideDAG(unsigned int nodeCount)
+{
+	const unsigned int width = std::max(2u, static_cast<unsigned int>(sqrt(nodeCount / 2.0)));
+	const unsigned int reduction = 2 * (width - 1) + 1; // pass + texture for each reduction, and the present node
+
+	const std::string constant = addFloat();
+
+	std::vector<std::string> layer;
+	std::vector<std::string> next;
+
+	std::vector<std::string> inputs;
+	std::vector<std::string> textures;
+
+	for (unsigned int i = 0; i < width; ++i)
+	{
+		addPass(std::vector<std::string>(1, constant), 1, textures);
+		layer.push_back(textures[0]);
+	}
+
+	while (m_nodes.size() + 2 * width + reduction <= nodeCount)
+	{
+		next.clear();
+
+		for (unsigned int i = 0; i < width; ++i)
+		{
+			// every texture is read at least once, plus one or two other distinct textures
+			const unsigned int j = (i + 1 + random(width - 1)) % width;
+
+			inputs.clear();
+			inputs.push_back(layer[i]);
+			inputs.push_back(layer[j]);
+
+			if (width > 2 && random(2) == 0)
+			{
+				unsigned int k = random(width);
+
+				while (k == i || k == j)
+				{
+					k = (k + 1) % width;
+				}
+
+				inputs.push_back(layer[k]);
+			}
+
+			addPass(inputs, 1, textures);
+			next.push_back(textures[0]);
+		}
+
+		layer.swap(next);
+	}
+
+	while (layer.size() > 1)
+	{
+		next.clear();
+
+		for (unsigned int i = 0; i + 1 < layer.size(); i += 2)
+		{
+			inputs.clear();
+			inputs.push_back(layer[i]);
+			inputs.push_back(layer[i + 1]);
+
+			addPass(inputs, 1, textures);
+			next.push_back(textures[0]);
+		}
+
+		if (layer.size() % 2 == 1)
+		{
+			next.push_back(layer.back());
+		}
+
+		layer.swap(next);
+	}
+
+	addPresent(layer[0]);
+}
+
+/**
+ * @brief A few passes fed by large expression DAGs : stresses the operator codegen and the common subexpression elimination
+ * @param nodeCount
+ */
+void GraphGenerator::generateOperatorHeavy(unsigned int nodeCount)
+{
+	const unsigned int window = 16; // operands are picked among the most recent values, which keeps the expressions deep
+	const unsigned int passCount = std::max(1u, nodeCount / 64);
+
+	std::vector<std::string> pool;
+
+	for (unsigned int i = 0; i < 8; ++i)
+	{
+		pool.push_back(addFloat());
+	}
+
+	std::set<std::string> unused; // operators not read yet, the next pass reads them
+
+	std::string texture;
+
+	std::vector<std::string> operands;
+	std::vector<std::string> inputs;
+	std::vector<std::string> textures;
+
+	for (unsigned int pass = 0; pass < passCount; ++pass)
+	{
+		const unsigned int limit = static_cast<unsigned int>(static_cast<unsigned long long>(nodeCount) * (pass + 1) / passCount);
+
+		while (m_nodes.size() + 3 <= limit) // pass + texture + present
+		{
+			const unsigned int size = std::min<unsigned int>(pool.size(), window);
+
+			operands.clear();
+			operands.push_back(pool[pool.size() - 1 - random(size)]);
+
+			const char * type = nullptr;
+
+			if (random(8) == 0)
+			{
+				type = UNARY_OPERATORS[random(sizeof(UNARY_OPERATORS)/sizeof(UNARY_OPERATORS[0]))];
+			}
+			else
+			{
+				std::string operand = pool[pool.size() - 1 - random(size)];
+
+				while (operand == operands[0])
+				{
+					operand = pool[pool.size() - 1 - random(size)];
+				}
+
+				operands.push_back(operand);
+
+				type = BINARY_OPERATORS[random(sizeof(BINARY_OPERATORS)/sizeof(BINARY_OPERATORS[0]))];
+			}
+
+			for (const std::string & operand : operands)
+			{
+				unused.erase(operand);
+			}
+
+			pool.push_back(addOperator(type, operands));
+			unused.insert(pool.back());
+
+			if (random(16) == 0 && m_nodes.size() + 4 <= limit)
+			{
+				pool.push_back(addOperator(type, operands)); // redundant expression
+				unused.insert(pool.back());
+			}
+		}
+
+		// sum what was not read, so that every operator reaches the pass (and passes keep a reasonable number of inputs)
+		std::vector<std::string> results(unused.begin(), unused.end());
+		unused.clear();
+
+		while (results.size() > 4)
+		{
+			std::vector<std::string> sums;
+
+			for (unsigned int i = 0; i + 1 < results.size(); i += 2)
+			{
+				operands.clear();
+				operands.push_back(results[i]);
+				operands.push_back(results[i + 1]);
+
+				sums.push_back(addOperator("addition", operands));
+			}
+
+			if (results.size() % 2 == 1)
+			{
+				sums.push_back(results.back());
+			}
+
+			results.swap(sums);
+		}
+
+		inputs.clear();
+
+		if (!texture.empty())
+		{
+			inputs.push_back(texture);
+		}
+
+		if (results.empty())
+		{
+			inputs.push_back(pool.back());
+		}
+
+		inputs.insert(inputs.end(), results.begin(), results.end());
+
+		addPass(inputs, 1, textures);
+		texture = textures[0];
+	}
+
+	addPresent(texture);
+}
+
+/**
+ * @brief Many passes with multiple render targets, reading random recent textures : stresses texture and framebuffer allocation
+ * @param nodeCount
+ */
+void GraphGenerator::generatePassPipeline(unsigned int nodeCount)
+{
+	const unsigned int window = 8;
+
+	std::vector<std::string> constants;
+
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		constants.push_back(addFloat());
+	}
+
+	std::vector<std::string> recent;
+
+	std::set<std::string> unused; // textures not read yet
+
+	std::vector<std::string> inputs;
+	std::vector<std::string> textures;
+
+	while (recent.empty() || m_nodes.size() + 6 <= nodeCount) // operator + pass + up to 3 textures + present
+	{
+		inputs.clear();
+
+		if (!recent.empty())
+		{
+			const unsigned int size = std::min<unsigned int>(recent.size(), window);
+			const unsigned int count = 1 + random(std::min(3u, size));
+
+			const unsigned int first = random(size);
+
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				inputs.push_back(recent[recent.size() - 1 - (first + i) % size]);
+			}
+
+			// textures leaving the window are read now, or never
+			if (recent.size() > window && unused.find(recent[recent.size() - 1 - window]) != unused.end() && std::find(inputs.begin(), inputs.end(), recent[recent.size() - 1 - window]) == inputs.end())
+			{
+				inputs.push_back(recent[recent.size() - 1 - window]);
+			}
+		}
+
+		inputs.push_back(constants[random(constants.size())]);
+
+		if (random(4) == 0)
+		{
+			std::vector<std::string> operands;
+			operands.push_back(constants[0]);
+			operands.push_back(constants[1 + random(constants.size() - 1)]);
+
+			inputs.push_back(addOperator("multiplication", operands));
+		}
+
+		for (const std::string & input : inputs)
+		{
+			unused.erase(input);
+		}
+
+		addPass(inputs, 1 + random(3), textures);
+
+		recent.insert(recent.end(), textures.begin(), textures.end());
+		unused.insert(textures.begin(), textures.end());
+	}
+
+	// the final passes read every texture that was not read yet
+	std::vector<std::string> results(unused.begin(), unused.end());
+
+	do
+	{
+		std::vector<std::string> merged;
+
+		for (unsigned int i = 0; i < results.size(); i += window)
+		{
+			inputs.assign(results.begin() + i, results.begin() + std::min<unsigned int>(i + window, results.size()));
+
+			addPass(inputs, 1, textures);
+			merged.push_back(textures[0]);
+		}
+
+		results.swap(merged);
+	}
+	while (results.size() > 1);
+
+	addPresent(results[0]);
+}
+
+/**
+ * @brief GraphGenerator::addNode
+ * @param type
+ * @param key metadata key (optional)
+ * @param value metadata value
+ * @return node id
+ */
+std::string GraphGenerator::addNode(const char * type, const char * key, const std::string & value)
+{
+	NodeDesc node;
+	node.id = "n" + std::to_string(m_nodes.size());
+	node.type = type;
+
+	if (key != nullptr)
+	{
+		node.key = key;
+		node.value = value;
+	}
+
+	m_nodes.push_back(node);
+
+	return(node.id);
+}
+
+/**
+ * @brief Add an edge, to the next input of the target
+ * @param source
+ * @param target
+ * @param sourceIndex output of the source
+ */
+void GraphGenerator::addEdge(const std::string & source, const std::string & target, unsigned int sourceIndex)
+{
+	EdgeDesc edge;
+	edge.source = source;
+	edge.target = target;
+	edge.source_id = sourceIndex;
+	edge.target_id = m_inputCounts[target]++;
+
+	m_edges.push_back(edge);
+}
+
+/**
+ * @brief GraphGenerator::addFloat
+ * @return
+ */
+std::string GraphGenerator::addFloat(void)
+{
+	return(addNode("float", "value", std::to_string(random(1000) / 100.0f)));
+}
+
+/**
+ * @brief GraphGenerator::addOperator
+ * @param type
+ * @param operands
+ * @return
+ */
+std::string GraphGenerator::addOperator(const char * type, const std::vector<std::string> & operands)
+{
+	std::string id = addNode(type);
+
+	for (const std::string & operand : operands)
+	{
+		addEdge(operand, id);
+	}
+
+	return(id);
+}
+
+/**
+ * @brief Add a pass and the textures it renders into
+ * @param inputs
+ * @param outputCount
+ * @param textures (output)
+ * @return
+ */
+std::string GraphGenerator::addPass(const std::vector<std::string> & inputs, unsigned int outputCount, std::vector<std::string> & textures)
+{
+	assert(outputCount > 0);
+
+	std::string id = addNode("pass", "subtype", "benchmark");
+
+	for (const std::string & input : inputs)
+	{
+		addEdge(input, id);
+	}
+
+	textures.clear();
+
+	for (unsigned int i = 0; i < outputCount; ++i)
+	{
+		std::string texture = addNode("texture", "format", TEXTURE_FORMATS[random(sizeof(TEXTURE_FORMATS)/sizeof(TEXTURE_FORMATS[0]))]);
+		addEdge(id, texture, i);
+		textures.push_back(texture);
+	}
+
+	return(id);
+}
+
+/**
+ * @brief GraphGenerator::addPresent
+ * @param texture
+ */
+void GraphGenerator::addPresent(const std::string & texture)
+{
+	std::string id = addNode("present");
+	addEdge(texture, id);
+}
+
+/**
+ * @brief Uniform random number in [0, n) (independent of the standard library distributions, which are not portable)
+ * @param n
+ * @return
+ */
+unsigned int GraphGenerator::random(unsigned int n)
+{
+	assert(n > 0);
+	return(static_cast<unsigned int>(m_random() % n));
+}
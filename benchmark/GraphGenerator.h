@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+
+/**
+ * @brief Shape of a synthetic graph
+ */
+enum class GraphShape
+{
+	DEEP_CHAIN,		// one long chain of passes, each reading the texture of the previous one
+	WIDE_DAG,		// layers of independent passes, reduced pairwise down to the final pass
+	OPERATOR_HEAVY,	// few passes fed by large expression DAGs of float operators
+	PASS_PIPELINE,	// many passes with multiple render targets, reading random recent textures
+};
+
+const char * getGraphShapeName(GraphShape shape);
+
+/**
+ * @brief Generates deterministic random graphs (the same seed, shape and size always give the same graph)
+ */
+class GraphGenerator
+{
+public:
+
+	explicit GraphGenerator(unsigned int seed);
+
+	std::string		generate		(GraphShape shape, unsigned int nodeCount);
+	bool			generateToFile	(GraphShape shape, unsigned int nodeCount, const char * path);
+
+	unsigned int	getNodeCount	(void) const { return(m_nodes.size()); }
+	unsigned int	getEdgeCount	(void) const { return(m_edges.size()); }
+
+protected:
+
+	void			generateDeepChain		(unsigned int nodeCount);
+	void			generateWideDAG			(unsigned int nodeCount);
+	void			generateOperatorHeavy	(unsigned int nodeCount);
+	void			generatePassPipeline	(unsigned int nodeCount);
+
+	std::string		addNode			(const char * type, const char * key = nullptr, const std::string & value = std::string());
+	void			addEdge			(const std::string & source, const std::string & target, unsigned int sourceIndex = 0);
+
+	std::string		addFloat		(void);
+	std::string		addOperator		(const char * type, const std::vector<std::string> & operands);
+	std::string		addPass			(const std::vector<std::string> & inputs, unsigned int outputCount, std::vector<std::string> & textures);
+	void			addPresent		(const std::string & texture);
+
+	unsigned int	random			(unsigned int n);
+
+private:
+
+	unsigned int m_seed;
+
+	std::mt19937 m_random;
+
+	struct NodeDesc
+	{
+		std::string id;
+		std::string type;
+		std::string key;
+		std::string value;
+	};
+
+	struct EdgeDesc
+	{
+		std::string source;
+		std::string target;
+		unsigned int source_id;
+		unsigned int target_id;
+	};
+
+	std::vector<NodeDesc> m_nodes;
+	std::vector<EdgeDesc> m_edges;
+
+	std::map<std::string, unsigned int> m_inputCounts; // node id -> number of incoming edges
+};
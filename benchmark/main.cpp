@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include "RenderGraph.h"
+
+#include "Graph.h"
+
+#include "GraphGenerator.h"
+
+//
+// Heap accounting : every allocation of the process goes through these operators (the compiler included)
+static std::atomic<size_t> g_heapCurrent(0);
+static std::atomic<size_t> g_heapPeak(0);
+static std::atomic<size_t> g_heapAllocations(0);
+
+static const size_t HEAP_HEADER_SIZE = 16; // keeps the returned memory aligned for any fundamental type
+
+// Once inlined next to a new expression, the free in operator delete is paired with operator new by GCC (-Wmismatched-new-delete)
+#if defined(_MSC_VER)
+#	define HEAP_NOINLINE __declspec(noinline)
+#else
+#	define HEAP_NOINLINE __attribute__((noinline))
+#endif
+
+void * operator new(size_t size)
+{
+	unsigned char * memory = static_cast<unsigned char*>(malloc(size + HEAP_HEADER_SIZE));
+
+	if (memory == nullptr)
+	{
+		abort(); // built without exceptions
+	}
+
+	*reinterpret_cast<size_t*>(memory) = size;
+
+	size_t current = g_heapCurrent.fetch_add(size) + size;
+	size_t peak = g_heapPeak.load();
+
+	while (current > peak && !g_heapPeak.compare_exchange_weak(peak, current))
+	{
+		// ...
+	}
+
+	++g_heapAllocations;
+
+	return(memory + HEAP_HEADER_SIZE);
+}
+
+HEAP_NOINLINE void operator delete(void * pointer) noexcept
+{
+	if (pointer != nullptr)
+	{
+		unsigned char * memory = static_cast<unsigned char*>(pointer) - HEAP_HEADER_SIZE;
+		g_heapCurrent -= *reinterpret_cast<size_t*>(memory);
+		free(memory);
+	}
+}
+
+void * operator new[](size_t size)
+{
+	return(operator new(size));
+}
+
+void operator delete[](void * pointer) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete[](void * pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+/**
+ * @brief Measurements of one graph
+ */
+struct Result
+{
+	unsigned int nodes;
+	unsigned int edges;
+	double seconds; // best compile time
+	size_t bytecode; // in bytes
+	size_t program; // serialized program, in bytes
+	size_t heapPeak; // peak heap usage during compilation, in bytes
+	size_t allocations; // per compilation
+};
+
+/**
+ * @brief Compile a graph several times, and keep the best time
+ * @param factory
+ * @param graph
+ * @param repeat
+ * @param result (output)
+ * @return
+ */
+static bool Measure(const RenderGraph::Factory & factory, const Graph & graph, unsigned int repeat, Result & result)
+{
+	result.seconds = HUGE_VAL;
+	result.bytecode = 0;
+	result.program = 0;
+	result.heapPeak = 0;
+	result.allocations = 0;
+
+	for (unsigned int i = 0; i < repeat; ++i)
+	{
+		RenderGraph::Program program;
+
+		const size_t heapBase = g_heapCurrent;
+		const size_t allocationsBase = g_heapAllocations;
+		g_heapPeak = heapBase;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if (!factory.compileGraph(graph, program))
+		{
+			return(false);
+		}
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		result.seconds = std::min(result.seconds, std::chrono::duration<double>(end - start).count());
+		result.heapPeak = g_heapPeak - heapBase;
+		result.allocations = g_heapAllocations - allocationsBase;
+
+		std::vector<uint8_t> buffer;
+		program.serialize(buffer);
+
+		result.bytecode = program.bytecode.size();
+		result.program = buffer.size();
+	}
+
+	return(true);
+}
+
+/**
+ * @brief Compile synthetic graphs of growing size and report how the compiler scales
+ *
+ * Usage : RenderGraphBenchmark [--seed N] [--repeat N] [--max-exponent X] [--output path]
+ * The exit code is not 0 when the compile time grows faster than nodes^X between two sizes (X = 1.5 by default),
+ * which catches superlinear blowups. Sizes below 1000 nodes are too fast to be checked reliably (the requested size : generated graphs can have a few nodes less).
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, char** argv)
+{
+	unsigned int seed = 1;
+	unsigned int repeat = 5;
+	double maxExponent = 1.5;
+	const char * path = "render-graph-benchmark.json";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+		{
+			seed = strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+		{
+			repeat = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+		}
+		else if (!strcmp(argv[i], "--max-exponent") && i + 1 < argc)
+		{
+			maxExponent = atof(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+		{
+			path = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Usage : %s [--seed N] [--repeat N] [--max-exponent X] [--output path]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	static const GraphShape SHAPES [] = { GraphShape::DEEP_CHAIN, GraphShape::WIDE_DAG, GraphShape::OPERATOR_HEAVY, GraphShape::PASS_PIPELINE };
+	static const unsigned int SIZES [] = { 10, 100, 1000, 10000 };
+
+	GraphGenerator generator(seed);
+
+	RenderGraph::Factory factory; // no cache : every compilation runs the whole compiler
+
+	int status = 0;
+
+	printf("%-16s %8s %8s %12s %10s %12s %12s %12s %10s %10s\n", "shape", "nodes", "edges", "compile (ms)", "us / node", "bytecode (B)", "program (B)", "heap (KB)", "allocs", "exponent");
+
+	for (GraphShape shape : SHAPES)
+	{
+		Result previous;
+		previous.nodes = 0;
+		previous.seconds = 0.0;
+
+		unsigned int previousSize = 0; // requested number of nodes of the previous graph
+
+		for (unsigned int size : SIZES)
+		{
+			if (!generator.generateToFile(shape, size, path))
+			{
+				fprintf(stderr, "Failed to write '%s'\n", path);
+				return -1;
+			}
+
+			Graph graph;
+
+			if (!graph.loadFromFile(path))
+			{
+				fprintf(stderr, "Failed to load '%s'\n", path);
+				return -1;
+			}
+
+			Result result;
+			result.nodes = generator.getNodeCount();
+			result.edges = generator.getEdgeCount();
+
+			// large graphs take long enough to be measured accurately once
+			if (!Measure(factory, graph, (size >= 10000) ? 1 : repeat, result))
+			{
+				fprintf(stderr, "Failed to compile %s graph of %u nodes\n", getGraphShapeName(shape), result.nodes);
+				status = 1;
+				break;
+			}
+
+			printf("%-16s %8u %8u %12.3f %10.3f %12zu %12zu %12.1f %10zu", getGraphShapeName(shape), result.nodes, result.edges, result.seconds * 1e3, result.seconds * 1e6 / result.nodes, result.bytecode, result.program, result.heapPeak / 1024.0, result.allocations);
+
+			if (previous.nodes > 0)
+			{
+				// compile time ~ nodes^exponent
+				const double exponent = log(result.seconds / previous.seconds) / log(double(result.nodes) / double(previous.nodes));
+
+				const bool bChecked = (previousSize >= 1000);
+				const bool bSuperlinear = bChecked && exponent > maxExponent;
+
+				printf(" %10.2f%s", exponent, bSuperlinear ? " !" : "");
+
+				if (bSuperlinear)
+				{
+					status = 1;
+				}
+			}
+
+			printf("\n");
+
+			previous = result;
+			previousSize = size;
+		}
+	}
+
+	remove(path);
+
+	return status;
+}
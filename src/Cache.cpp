@@ -0,0 +1,260 @@
+#include "Cache.h"
+
+#include "Program.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	include <sys/utime.h>
+#else
+#	include <dirent.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <utime.h>
+#endif
+
+static const char * CACHE_FILE_EXTENSION = ".rgp";
+
+struct CacheEntry
+{
+	std::string path;
+	size_t size;
+	uint64_t lastUse;
+};
+
+/**
+ * @brief List the cache files of a directory
+ * @param directory
+ * @param entries (output)
+ */
+static void ListCacheEntries(const std::string & directory, std::vector<CacheEntry> & entries)
+{
+	const size_t extensionLength = strlen(CACHE_FILE_EXTENSION);
+
+#if defined(_WIN32)
+
+	WIN32_FIND_DATAA data;
+
+	HANDLE hFind = FindFirstFileA((directory + "/*" + CACHE_FILE_EXTENSION).c_str(), &data);
+
+	if (hFind == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		CacheEntry entry;
+		entry.path = directory + "/" + data.cFileName;
+		entry.size = (size_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		entry.lastUse = (uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+		entries.push_back(entry);
+	}
+	while (FindNextFileA(hFind, &data));
+
+	FindClose(hFind);
+
+#else
+
+	DIR * dir = opendir(directory.c_str());
+
+	if (dir == nullptr)
+	{
+		return;
+	}
+
+	while (struct dirent * ent = readdir(dir))
+	{
+		const size_t length = strlen(ent->d_name);
+
+		if (length <= extensionLength || strcmp(ent->d_name + length - extensionLength, CACHE_FILE_EXTENSION) != 0)
+		{
+			continue;
+		}
+
+		CacheEntry entry;
+		entry.path = directory + "/" + ent->d_name;
+
+		struct stat st;
+
+		if (stat(entry.path.c_str(), &st) == 0)
+		{
+			entry.size = size_t(st.st_size);
+#if defined(__APPLE__)
+			entry.lastUse = uint64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+			entry.lastUse = uint64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+			entries.push_back(entry);
+		}
+	}
+
+	closedir(dir);
+
+#endif
+}
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Constructor
+ * @param directory_
+ * @param maxSize_ maximum total size of the cache files (in bytes)
+ */
+ProgramCache::ProgramCache(const char * directory_, size_t maxSize_) : directory(directory_), maxSize(maxSize_), hits(0), misses(0), evictions(0)
+{
+	// ...
+}
+
+/**
+ * @brief Destructor
+ */
+ProgramCache::~ProgramCache(void)
+{
+	// ...
+}
+
+/**
+ * @brief Load a previously stored program
+ * @param key
+ * @param program (output)
+ * @return false on miss
+ */
+bool ProgramCache::load(uint64_t key, Program & program)
+{
+	const std::string path = getPath(key);
+
+	if (!program.loadFromFile(path.c_str()))
+	{
+		++misses;
+		return(false);
+	}
+
+	// mark as recently used
+	utime(path.c_str(), nullptr);
+
+	++hits;
+
+	return(true);
+}
+
+/**
+ * @brief Store a program, then evict the least recently used programs if the cache is too big
+ * @param key
+ * @param program
+ * @return
+ */
+bool ProgramCache::store(uint64_t key, const Program & program)
+{
+	const std::string path = getPath(key);
+
+	// unique per process / thread, so that concurrent stores of the same program do not write the same file
+#if defined(_WIN32)
+	const unsigned long processId = GetCurrentProcessId();
+#else
+	const unsigned long processId = getpid();
+#endif
+	const size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+	const std::string tmpPath = path + "." + std::to_string(processId) + "." + std::to_string(threadId) + ".tmp";
+
+	if (!program.saveToFile(tmpPath.c_str()))
+	{
+		remove(tmpPath.c_str());
+		return(false);
+	}
+
+#if defined(_WIN32)
+	remove(path.c_str()); // rename does not replace existing files on Windows
+#endif
+
+	if (rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		return(false);
+	}
+
+	evict(path);
+
+	return(true);
+}
+
+/**
+ * @brief ProgramCache::getStatistics
+ * @return
+ */
+CacheStatistics ProgramCache::getStatistics(void) const
+{
+	CacheStatistics statistics;
+	statistics.hits = hits;
+	statistics.misses = misses;
+	statistics.evictions = evictions;
+	return(statistics);
+}
+
+/**
+ * @brief ProgramCache::getPath
+ * @param key
+ * @return
+ */
+std::string ProgramCache::getPath(uint64_t key) const
+{
+	char name [32];
+	snprintf(name, sizeof(name), "%016" PRIx64 "%s", key, CACHE_FILE_EXTENSION);
+
+	return(directory + "/" + name);
+}
+
+/**
+ * @brief Remove least recently used programs until the cache fits in maxSize
+ * @param keepPath program that was just stored (never evicted)
+ */
+void ProgramCache::evict(const std::string & keepPath)
+{
+	std::vector<CacheEntry> entries;
+	ListCacheEntries(directory, entries);
+
+	size_t totalSize = 0;
+
+	for (const CacheEntry & entry : entries)
+	{
+		totalSize += entry.size;
+	}
+
+	if (totalSize <= maxSize)
+	{
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [] (const CacheEntry & a, const CacheEntry & b) { return a.lastUse < b.lastUse; });
+
+	for (const CacheEntry & entry : entries)
+	{
+		if (totalSize <= maxSize)
+		{
+			break;
+		}
+
+		if (entry.path == keepPath)
+		{
+			continue;
+		}
+
+		if (remove(entry.path.c_str()) == 0)
+		{
+			totalSize -= entry.size;
+			++evictions;
+		}
+	}
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace RenderGraph
+{
+
+class Program;
+
+struct CacheStatistics
+{
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+};
+
+/**
+ * @brief On-disk store of compiled programs, addressed by a hash of their inputs, bounded in size (LRU eviction)
+ * Can be used from several threads (and several processes sharing the same directory)
+ */
+class ProgramCache
+{
+public:
+
+	ProgramCache(const char * directory, size_t maxSize);
+	~ProgramCache(void);
+
+	bool load(uint64_t key, Program & program);
+	bool store(uint64_t key, const Program & program);
+
+	CacheStatistics getStatistics(void) const;
+
+private:
+
+	std::string getPath(uint64_t key) const;
+
+	void evict(const std::string & keepPath);
+
+	const std::string directory;
+	const size_t maxSize;
+
+	std::atomic<unsigned int> hits;
+	std::atomic<unsigned int> misses;
+	std::atomic<unsigned int> evictions;
+};
+
+/**
+ * @brief 64-bit FNV-1a hash, used to build cache keys
+ */
+class Hash
+{
+public:
+
+	Hash(void) : value(UINT64_C(14695981039346656037))
+	{
+		// ...
+	}
+
+	void update(const void * data, size_t size)
+	{
+		const uint8_t * bytes = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			value ^= bytes[i];
+			value *= UINT64_C(1099511628211);
+		}
+	}
+
+	void update(const std::string & str)
+	{
+		update(str.data(), str.size() + 1); // include terminator so that "ab" + "c" != "a" + "bc"
+	}
+
+	uint64_t get(void) const
+	{
+		return(value);
+	}
+
+private:
+
+	uint64_t value;
+};
+
+}
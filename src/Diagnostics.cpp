@@ -0,0 +1,250 @@
+#include "Diagnostics.h"
+
+#include <stdio.h>
+
+static const char * INSTRUCTION_NAMES [] =
+{
+	"NOP",
+
+	"PUSH",
+	"POP",
+
+	"ADD",
+	"SUB",
+	"MUL",
+	"DIV",
+	"MOD",
+
+	"NEG",
+	"ABS",
+	"FMA",
+
+	"EQ",
+	"NEQ",
+	"GT",
+	"GTE",
+	"LT",
+	"LTE",
+
+	"NOT",
+	"AND",
+	"OR",
+
+	"JMP",
+	"JMPT",
+	"JMPF",
+
+	"CALL",
+	"INVOKE",
+	"RET",
+	"BEGIN",
+	"RESUME",
+	"DRAW",
+	"END",
+	"RESOLVE",
+	"HALT"
+};
+
+static_assert (sizeof(INSTRUCTION_NAMES)/sizeof(INSTRUCTION_NAMES[0]) == uint8_t(RenderGraph::OpCode::HALT) + 1, "Missing instruction names");
+
+static const char * COMPILE_PHASE_NAMES [] =
+{
+	"classify",
+	"sort",
+	"schedule",
+	"allocate",
+	"create operations",
+	"codegen"
+};
+
+static_assert (sizeof(COMPILE_PHASE_NAMES)/sizeof(COMPILE_PHASE_NAMES[0]) == uint8_t(RenderGraph::CompilePhase::CODEGEN) + 1, "Missing compile phase names");
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Destructor
+ */
+Diagnostics::~Diagnostics(void)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onPhase
+ * @param phase
+ * @param seconds
+ */
+void Diagnostics::onPhase(CompilePhase /*phase*/, double /*seconds*/)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onSchedule
+ * @param framebufferChanges
+ * @param textureBinds
+ * @param peakBytesPerPixel
+ */
+void Diagnostics::onSchedule(unsigned int /*framebufferChanges*/, unsigned int /*textureBinds*/, unsigned int /*peakBytesPerPixel*/)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onValue
+ * @param index
+ * @param nodeId
+ * @param output
+ * @param kind
+ * @param initial
+ */
+void Diagnostics::onValue(unsigned int /*index*/, const char * /*nodeId*/, unsigned int /*output*/, ValueKind /*kind*/, Value /*initial*/)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onTexture
+ * @param index
+ * @param nodeId
+ * @param format
+ */
+void Diagnostics::onTexture(unsigned int /*index*/, const char * /*nodeId*/, TextureFormat /*format*/)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onTextureAliasing
+ * @param textureCount
+ * @param allocationCount
+ * @param savedBytesPerPixel
+ */
+void Diagnostics::onTextureAliasing(unsigned int /*textureCount*/, unsigned int /*allocationCount*/, unsigned int /*savedBytesPerPixel*/)
+{
+	// ...
+}
+
+/**
+ * @brief Diagnostics::onInstruction
+ * @param offset
+ * @param opcode
+ * @param operand
+ */
+void Diagnostics::onInstruction(unsigned int /*offset*/, OpCode /*opcode*/, unsigned int /*operand*/)
+{
+	// ...
+}
+
+/**
+ * @brief DiagnosticsPrinter::onPhase
+ * @param phase
+ * @param seconds
+ */
+void DiagnosticsPrinter::onPhase(CompilePhase phase, double seconds)
+{
+	printf("PHASE %s : %.3f ms\n", getCompilePhaseName(phase), seconds * 1000.0);
+}
+
+/**
+ * @brief DiagnosticsPrinter::onSchedule
+ * @param framebufferChanges
+ * @param textureBinds
+ * @param peakBytesPerPixel
+ */
+void DiagnosticsPrinter::onSchedule(unsigned int framebufferChanges, unsigned int textureBinds, unsigned int peakBytesPerPixel)
+{
+	printf("SCHEDULE %u framebuffer changes, %u texture binds, %u bytes per pixel (peak)\n", framebufferChanges, textureBinds, peakBytesPerPixel);
+}
+
+/**
+ * @brief DiagnosticsPrinter::onValue
+ * @param index
+ * @param nodeId
+ * @param output
+ * @param kind
+ * @param initial
+ */
+void DiagnosticsPrinter::onValue(unsigned int index, const char * nodeId, unsigned int output, ValueKind kind, Value initial)
+{
+	if (kind == ValueKind::CONSTANT)
+	{
+		printf("MEM[%u] (const float) = %f (%s)\n", index, initial.asFloat, nodeId);
+	}
+	else if (kind == ValueKind::INPUT)
+	{
+		printf("MEM[%u] (input) (%s)\n", index, nodeId);
+	}
+	else
+	{
+		printf("MEM[%u] (output %u) = %u (%s)\n", index, output, initial.asUInt, nodeId);
+	}
+}
+
+/**
+ * @brief DiagnosticsPrinter::onTexture
+ * @param index
+ * @param nodeId
+ * @param format
+ */
+void DiagnosticsPrinter::onTexture(unsigned int index, const char * nodeId, TextureFormat format)
+{
+	printf("TEXTURE[%u] = %d (%s)\n", index, int(format), nodeId);
+}
+
+/**
+ * @brief DiagnosticsPrinter::onTextureAliasing
+ * @param textureCount
+ * @param allocationCount
+ * @param savedBytesPerPixel
+ */
+void DiagnosticsPrinter::onTextureAliasing(unsigned int textureCount, unsigned int allocationCount, unsigned int savedBytesPerPixel)
+{
+	printf("ALIASING %u textures in %u allocations, %u bytes per pixel saved\n", textureCount, allocationCount, savedBytesPerPixel);
+}
+
+/**
+ * @brief DiagnosticsPrinter::onInstruction
+ * @param offset
+ * @param opcode
+ * @param operand
+ */
+void DiagnosticsPrinter::onInstruction(unsigned int offset, OpCode opcode, unsigned int operand)
+{
+	if (getOperandSize(opcode) > 0)
+	{
+		printf("%04u %s %u\n", offset, getInstructionName(opcode), operand);
+	}
+	else
+	{
+		printf("%04u %s\n", offset, getInstructionName(opcode));
+	}
+}
+
+/**
+ * @brief getInstructionName
+ * @param opcode
+ * @return
+ */
+const char * getInstructionName(OpCode opcode)
+{
+	if (uint8_t(opcode) > uint8_t(OpCode::HALT))
+	{
+		return "???";
+	}
+
+	return INSTRUCTION_NAMES[uint8_t(opcode)];
+}
+
+/**
+ * @brief getCompilePhaseName
+ * @param phase
+ * @return
+ */
+const char * getCompilePhaseName(CompilePhase phase)
+{
+	return COMPILE_PHASE_NAMES[uint8_t(phase)];
+}
+
+}
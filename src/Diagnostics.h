@@ -0,0 +1,76 @@
+#pragma once
+
+#include "VM.h"
+#include "Formats.h"
+
+namespace RenderGraph
+{
+
+enum class CompilePhase : uint8_t
+{
+	CLASSIFY,
+	SORT,
+	SCHEDULE,
+	ALLOCATE,
+	CREATE_OPERATIONS,
+	CODEGEN
+};
+
+enum class ValueKind : uint8_t
+{
+	CONSTANT,
+	INPUT, // subgraph input, written when the subgraph is invoked
+	TEMPORARY
+};
+
+/**
+ * @brief Receives what the Factory compiles (value memory, textures, disassembly) and how long each phase took
+ * Nothing is reported unless a sink is attached to the Factory (see Factory::setDiagnostics)
+ */
+class Diagnostics
+{
+public:
+
+	virtual ~Diagnostics(void);
+
+	//
+	// Compile phases
+	virtual void	onPhase			(CompilePhase phase, double seconds);
+
+	//
+	// Pass scheduling
+	virtual void	onSchedule		(unsigned int framebufferChanges, unsigned int textureBinds, unsigned int peakBytesPerPixel);
+
+	//
+	// Memory layout
+	virtual void	onValue			(unsigned int index, const char * nodeId, unsigned int output, ValueKind kind, Value initial);
+	virtual void	onTexture		(unsigned int index, const char * nodeId, TextureFormat format);
+	virtual void	onTextureAliasing	(unsigned int textureCount, unsigned int allocationCount, unsigned int savedBytesPerPixel);
+
+	//
+	// Disassembly
+	virtual void	onInstruction	(unsigned int offset, OpCode opcode, unsigned int operand);
+};
+
+/**
+ * @brief Diagnostics sink writing a human readable compile log to stdout
+ */
+class DiagnosticsPrinter : public Diagnostics
+{
+public:
+
+	virtual void	onPhase			(CompilePhase phase, double seconds) override;
+
+	virtual void	onSchedule		(unsigned int framebufferChanges, unsigned int textureBinds, unsigned int peakBytesPerPixel) override;
+
+	virtual void	onValue			(unsigned int index, const char * nodeId, unsigned int output, ValueKind kind, Value initial) override;
+	virtual void	onTexture		(unsigned int index, const char * nodeId, TextureFormat format) override;
+	virtual void	onTextureAliasing	(unsigned int textureCount, unsigned int allocationCount, unsigned int savedBytesPerPixel) override;
+
+	virtual void	onInstruction	(unsigned int offset, OpCode opcode, unsigned int operand) override;
+};
+
+const char * getInstructionName(OpCode opcode);
+const char * getCompilePhaseName(CompilePhase phase);
+
+}
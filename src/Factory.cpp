@@ -4,8 +4,14 @@
 #include "Instance.h"
 
 #include "Texture.h"
+#include "TexturePool.h"
 #include "Framebuffer.h"
 
+#include "Diagnostics.h"
+#include "Program.h"
+#include "Cache.h"
+#include "Scheduler.h"
+
 #include "Graph.h"
 #include "Node.h"
 #include "Edge.h"
@@ -15,6 +21,10 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
 
 #include "OpenGL.h"
 
@@ -35,18 +45,23 @@ static void createGraphAlias(const Graph & graph, Graph & outGraph)
 	}
 }
 
-static bool ApplyTopologicalOrdering(const Graph & graph, std::vector<Node*> & L, Node * n)
+/**
+ * @brief Order the nodes reaching the roots (Kahn's algorithm on the reversed graph)
+ * @param graph
+ * @param L (output) nodes in reverse execution order, the roots first
+ * @param roots present node, or output nodes of a subgraph
+ * @return false if the graph has a cycle
+ */
+static bool ApplyTopologicalOrdering(const Graph & graph, std::vector<Node*> & L, const std::vector<Node*> & roots)
 {
 	Graph G;
 
 	createGraphAlias(graph, G);
 
-	std::vector<Node*> S; S.push_back(n); // S ← Set of all nodes with no incoming edges
+	std::vector<Node*> S; // S ← Set of all nodes with no incoming edges
 
-	while (!S.empty())
+	auto visit = [&](Node * n)
 	{
-		Node * n = S.back(); S.pop_back(); // remove a node n from S
-
 		L.push_back(n); // add n to tail of L
 
 		std::vector<Edge*> edges;
@@ -66,6 +81,19 @@ static bool ApplyTopologicalOrdering(const Graph & graph, std::vector<Node*> & L
 				S.push_back(m); // insert m into S
 			}
 		}
+	};
+
+	// All roots run last : the outputs of a subgraph are pushed once everything else ran
+	for (Node * n : roots)
+	{
+		visit(n);
+	}
+
+	while (!S.empty())
+	{
+		Node * n = S.back(); S.pop_back(); // remove a node n from S
+
+		visit(n);
 	}
 
 	//
@@ -82,810 +110,3580 @@ static bool ApplyTopologicalOrdering(const Graph & graph, std::vector<Node*> & L
 	return(true);
 }
 
-static const char * INSTRUCTION_NAMES [] =
-{
-	"NOP",
-
-	"PUSH",
-	"POP",
-
-	"ADD",
-	"SUB",
-	"MUL",
-	"DIV",
-
-	"NEG",
-	"ABS",
-	"FMA",
-
-	"EQ",
-	"NEQ",
-	"GT",
-	"GTE",
-	"LT",
-	"LTE",
+/**
+ * @brief Metadata read by the compiler (anything else does not change the compiled program)
+ */
+static const char * COMPILER_NODE_METADATA [] = { "value", "format", "subtype", "graph", "index", "scale", "width", "height", "samples", "levels", "mipmap", "level" };
+static const char * COMPILER_EDGE_METADATA [] = { "source_id", "target_id" };
 
-	"NOT",
-	"AND",
-	"OR",
+static bool IsCommutativeOperator(const std::string & type)
+{
+	return type == "addition" || type == "multiplication" || type == "equal_to" || type == "not_equal_to" || type == "and" || type == "or";
+}
 
-	"JMP",
-	"JMPT",
-	"JMPF",
+/**
+ * @brief Hash-consing of operator nodes : structurally identical operators (same type, same inputs) are merged
+ * @param graph
+ * @param queue nodes in reverse execution order (as returned by ApplyTopologicalOrdering)
+ * @param operators operator nodes
+ * @param mapAliases (output) duplicate node id -> canonical node id
+ */
+static void EliminateCommonSubexpressions(const Graph & graph, const std::vector<Node*> & queue, const std::vector<Node*> & operators, std::map<std::string, std::string> & mapAliases)
+{
+	mapAliases.clear();
 
-	"CALL",
-	"HALT"
-};
+	const std::set<const Node*> setOperators(operators.begin(), operators.end());
 
-static_assert (sizeof(INSTRUCTION_NAMES)/sizeof(INSTRUCTION_NAMES[0]) == uint8_t(RenderGraph::OpCode::HALT), "Missing instruction names");
+	std::map<std::string, std::string> mapExpressions; // expression key -> canonical node id
 
-static inline void genOperatorBytecode(RenderGraph::OpCode opcode, unsigned int numParams, const Graph & graph, Node * node, const std::map<std::string, std::vector<unsigned int>> & mapValues, std::vector<uint8_t> & bytecode)
-{
-	//
-	// Inputs
-	const std::vector<uint16_t> inputs = [&]
+	// Visit nodes in execution order : inputs are canonicalized before their consumers, and the canonical node is
+	// always the first occurrence of an expression (so it is computed before any consumer of its duplicates)
+	for (std::vector<Node*>::const_reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
 	{
-		std::vector<uint16_t> values;
+		Node * node = *it;
+
+		if (setOperators.find(node) == setOperators.end())
+		{
+			continue;
+		}
 
 		std::vector<Edge*> inEdges;
 		graph.getEdgeTo(node, inEdges);
 
-		values.resize(numParams);
+		std::vector<std::pair<int, std::string>> operands;
+		operands.reserve(inEdges.size());
 
 		for (Edge * edge : inEdges)
 		{
-			Node * source = edge->getSource();
+			std::string strSourceId = edge->getSource()->getId();
 
-			const std::string & strId = source->getId();
+			auto itAlias = mapAliases.find(strSourceId);
 
-			const std::string & source_id = edge->getMetaData("source_id");
-			int outputParamIndex = atoi(source_id.c_str());
-			assert(outputParamIndex < UINT8_MAX);
+			if (itAlias != mapAliases.end())
+			{
+				strSourceId = itAlias->second;
+			}
 
-			const std::string & target_id = edge->getMetaData("target_id");
-			int inputParamIndex = atoi(target_id.c_str());
-			assert(inputParamIndex < UINT8_MAX);
+			int inputParamIndex = atoi(edge->getMetaData("target_id").c_str());
 
-			assert(source->getType() != "present" && source->getType() != "texture");
-			{
-				auto it = mapValues.find(strId);
+			operands.push_back(std::pair<int, std::string>(inputParamIndex, strSourceId + ':' + edge->getMetaData("source_id")));
+		}
 
-				if (it != mapValues.end())
-				{
-					unsigned int index = it->second[outputParamIndex];
-					uint16_t addr = (0 << 15) | (index & 0x7FFF);
-					values[inputParamIndex] = addr;
-				}
-				else
-				{
-					assert(false);
-				}
+		std::sort(operands.begin(), operands.end());
+
+		if (IsCommutativeOperator(node->getType()))
+		{
+			for (std::pair<int, std::string> & operand : operands)
+			{
+				operand.first = 0;
 			}
-		}
 
-		return values;
-	} ();
+			std::sort(operands.begin(), operands.end());
+		}
 
-	assert(inputs.size() == numParams);
+		std::string strKey = node->getType();
 
-	//
-	// Output
-	uint16_t output = [&]
-	{
-		uint16_t value = 0;
+		for (const std::pair<int, std::string> & operand : operands)
+		{
+			strKey += '\x1F';
+			strKey += std::to_string(operand.first);
+			strKey += '=';
+			strKey += operand.second;
+		}
 
-		auto it = mapValues.find(node->getId());
+		auto itExpression = mapExpressions.find(strKey);
 
-		if (it != mapValues.end())
+		if (itExpression != mapExpressions.end())
 		{
-			assert(it->second.size() == 1); // operators have exactly 1 output
-			unsigned int index = it->second[0];
-			uint16_t addr = (0 << 15) | (index & 0x7FFF);
-			value = addr;
+			mapAliases.insert(std::pair<std::string, std::string>(node->getId(), itExpression->second));
 		}
 		else
 		{
-			assert(false);
+			mapExpressions.insert(std::pair<std::string, std::string>(strKey, node->getId()));
 		}
+	}
+}
 
-		return value;
-	} ();
+/**
+ * @brief Find the node output read through an input edge (reading a texture means reading the output of the pass that renders it)
+ * @param graph
+ * @param edge input edge
+ * @param mapAliases duplicate node id -> canonical node id
+ * @param strId (output) id of the node producing the value
+ * @param outputParamIndex (output) output index in the producing node
+ * @return false if the edge does not carry any value
+ */
+static bool ResolveValueSource(const Graph & graph, Edge * edge, const std::map<std::string, std::string> & mapAliases, std::string & strId, unsigned int & outputParamIndex)
+{
+	Node * source = edge->getSource();
 
-	//
-	// Gen bytecode
-	for (int i = 0; i < numParams; ++i)
+	if (source->getType() == "texture")
 	{
-		bytecode.push_back(uint8_t(RenderGraph::OpCode::PUSH));
-		bytecode.push_back(uint8_t((inputs[i] >> 8) & 0xFF));
-		bytecode.push_back(uint8_t((inputs[i]) & 0xFF));
-		printf("PUSH %d\n", inputs[i]);
-	}
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(source, inEdges);
 
-	{
-		bytecode.push_back(uint8_t(opcode));
-		bytecode.push_back(uint8_t(2)); // float
-		printf("%s (float)\n", INSTRUCTION_NAMES[uint8_t(opcode)]);
+		if (inEdges.empty())
+		{
+			return(false);
+		}
+
+		edge = inEdges[0];
+		source = edge->getSource();
 	}
 
+	strId = source->getId();
+	outputParamIndex = atoi(edge->getMetaData("source_id").c_str());
+
+	auto it = mapAliases.find(strId);
+
+	if (it != mapAliases.end())
 	{
-		bytecode.push_back(uint8_t(RenderGraph::OpCode::POP));
-		bytecode.push_back(uint8_t((output >> 8) & 0xFF));
-		bytecode.push_back(uint8_t((output) & 0xFF));
-		printf("POP %d\n", output);
+		strId = it->second;
 	}
+
+	return(true);
 }
 
-static inline void genOperationBytecode(const std::map<std::string, unsigned int> & mapOperations, const std::map<std::string, unsigned int> & mapTextures, const Graph & graph, Node * node, const std::map<std::string, std::vector<unsigned int>> & mapValues, std::vector<uint8_t> & bytecode)
+/**
+ * @brief Cost of an execution order, see SchedulePasses
+ */
+struct ScheduleCost
 {
-	//
-	// Inputs
-	const std::vector<uint16_t> inputs = [&]
-	{
-		std::vector<uint16_t> values;
-
-		std::vector<Edge*> inEdges;
-		graph.getEdgeTo(node, inEdges);
+	unsigned int framebufferChanges; // passes rendering into other attachments than the previous pass
+	unsigned int textureBinds; // textures read by a pass and not by the previous pass
+	unsigned int peakBytesPerPixel; // render targets alive at the same time
+};
 
-		values.resize(inEdges.size());
+// Weights of the cost model, in bytes per pixel of render target memory
+static const unsigned int SCHEDULE_FRAMEBUFFER_CHANGE_COST = 16;
+static const unsigned int SCHEDULE_TEXTURE_BIND_COST = 4;
 
-		for (Edge * edge : inEdges)
-		{
-			Node * source = edge->getSource();
+/**
+ * @brief Textures read / written by a pass, and the passes it depends on
+ */
+struct ScheduledPass
+{
+	Node * node;
+	std::vector<Node*> inputs; // texture nodes
+	std::vector<Node*> outputs; // texture nodes (sorted, two passes with the same outputs share the attachments)
+};
 
-			const std::string & strId = source->getId();
+/**
+ * @brief Render target state while simulating an execution order
+ */
+class ScheduleSimulation
+{
+public:
 
-			const std::string & source_id = edge->getMetaData("source_id");
-			int outputParamIndex = atoi(source_id.c_str());
-			assert(outputParamIndex < UINT8_MAX);
+	ScheduleSimulation(const std::vector<ScheduledPass> & passes, const std::map<const Node*, unsigned int> & bytesPerPixel, const std::vector<Node*> & presented) : m_passes(passes), m_bytesPerPixel(bytesPerPixel), m_pPrevious(nullptr), m_liveBytes(0)
+	{
+		m_cost.framebufferChanges = 0;
+		m_cost.textureBinds = 0;
+		m_cost.peakBytesPerPixel = 0;
 
-			const std::string & target_id = edge->getMetaData("target_id");
-			int inputParamIndex = atoi(target_id.c_str());
-			assert(inputParamIndex < UINT8_MAX);
+		for (Node * texture : presented)
+		{
+			++m_remainingReaders[texture]; // read after the last pass, never released
+		}
 
-			if (source->getType() == "texture")
+		for (const ScheduledPass & pass : passes)
+		{
+			for (Node * texture : pass.inputs)
 			{
-				std::vector<Edge*> inEdges2;
-				graph.getEdgeTo(source, inEdges2);
-
-				if (inEdges2.size() > 0)
-				{
-					Edge * edge2 = inEdges2[0];
-
-					Node * source2 = edge2->getSource();
+				++m_remainingReaders[texture];
+			}
 
-					const std::string & strId = source2->getId();
+			for (Node * texture : pass.outputs)
+			{
+				++m_remainingWriters[texture];
+			}
+		}
+	}
 
-					const std::string & source_id = edge2->getMetaData("source_id");
-					int outputParamIndex = atoi(source_id.c_str());
-					assert(outputParamIndex < UINT8_MAX);
+	/**
+	 * @brief Cost of running a pass now (lower is better), memory allocated minus memory released counts as well
+	 */
+	int evaluate(unsigned int index) const
+	{
+		const ScheduledPass & pass = m_passes[index];
 
-					assert(source2->getType() != "present" && source2->getType() != "texture");
+		int cost = 0;
 
-					auto it = mapValues.find(strId);
+		if (m_pPrevious == nullptr || m_pPrevious->outputs != pass.outputs)
+		{
+			cost += SCHEDULE_FRAMEBUFFER_CHANGE_COST;
+		}
 
-					if (it != mapValues.end())
-					{
-						unsigned int index = it->second[outputParamIndex];
-						uint16_t addr = (0 << 15) | (index & 0x7FFF);
-						values[inputParamIndex] = addr;
-					}
-					else
-					{
-						assert(false);
-					}
-				}
-			}
-			else
+		for (Node * texture : pass.inputs)
+		{
+			if (m_pPrevious == nullptr || std::find(m_pPrevious->inputs.begin(), m_pPrevious->inputs.end(), texture) == m_pPrevious->inputs.end())
 			{
-				assert(source->getType() != "present" && source->getType() != "texture");
-
-				auto it = mapValues.find(strId);
+				cost += SCHEDULE_TEXTURE_BIND_COST;
+			}
 
-				if (it != mapValues.end())
-				{
-					unsigned int index = it->second[outputParamIndex];
-					uint16_t addr = (0 << 15) | (index & 0x7FFF);
-					values[inputParamIndex] = addr;
-				}
-				else
-				{
-					assert(false);
-				}
+			if (m_remainingReaders.at(texture) == 1 && m_remainingWriters.at(texture) == 0)
+			{
+				cost -= int(getBytesPerPixel(texture)); // released
 			}
 		}
 
-		return values;
-	} ();
+		for (Node * texture : pass.outputs)
+		{
+			if (m_live.find(texture) == m_live.end())
+			{
+				cost += int(getBytesPerPixel(texture)); // allocated
+			}
+		}
 
-	assert(inputs.size() < UINT8_MAX);
+		return(cost);
+	}
 
-	//
-	// Outputs
-	const std::vector<uint16_t> outputs = [&]
+	/**
+	 * @brief Run a pass
+	 */
+	void execute(unsigned int index)
 	{
-		std::vector<uint16_t> values;
-
-		std::vector<Edge*> outEdges;
-		graph.getEdgeFrom(node, outEdges);
-
-		values.resize(outEdges.size());
+		const ScheduledPass & pass = m_passes[index];
 
-		for (Edge * edge : outEdges)
+		if (m_pPrevious == nullptr || m_pPrevious->outputs != pass.outputs)
 		{
-			Node * target = edge->getTarget();
-
-			const std::string & strId = target->getId();
-
-			const std::string & source_id = edge->getMetaData("source_id");
-			int outputParamIndex = atoi(source_id.c_str());
-			assert(outputParamIndex < UINT8_MAX);
+			++m_cost.framebufferChanges;
+		}
 
-			const std::string & target_id = edge->getMetaData("target_id");
-			int inputParamIndex = atoi(target_id.c_str());
-			assert(inputParamIndex < UINT8_MAX);
+		for (Node * texture : pass.inputs)
+		{
+			if (m_pPrevious == nullptr || std::find(m_pPrevious->inputs.begin(), m_pPrevious->inputs.end(), texture) == m_pPrevious->inputs.end())
+			{
+				++m_cost.textureBinds;
+			}
+		}
 
-			auto it = mapValues.find(node->getId());
+		for (Node * texture : pass.outputs)
+		{
+			--m_remainingWriters[texture];
 
-			if (it != mapValues.end())
+			if (m_live.insert(texture).second)
 			{
-				unsigned int index = it->second[outputParamIndex];
-				uint16_t addr = (0 << 15) | (index & 0x7FFF);
-				values[values.size() - 1 - outputParamIndex] = addr; // pop in reverse order
+				m_liveBytes += getBytesPerPixel(texture);
 			}
-			else
+		}
+
+		m_cost.peakBytesPerPixel = std::max(m_cost.peakBytesPerPixel, m_liveBytes);
+
+		for (Node * texture : pass.inputs)
+		{
+			if (--m_remainingReaders[texture] == 0 && m_remainingWriters[texture] == 0 && m_live.erase(texture) > 0)
 			{
-				assert(false);
+				m_liveBytes -= getBytesPerPixel(texture);
 			}
 		}
 
-		return values;
-	} ();
-
-	assert(outputs.size() < UINT8_MAX);
+		m_pPrevious = &pass;
+	}
 
-	//
-	// Gen bytecode
-	for (int i = 0; i < inputs.size(); ++i)
+	const ScheduleCost & getCost(void) const
 	{
-		bytecode.push_back(uint8_t(RenderGraph::OpCode::PUSH));
-		bytecode.push_back(uint8_t((inputs[i] >> 8) & 0xFF));
-		bytecode.push_back(uint8_t((inputs[i]) & 0xFF));
-		printf("PUSH %d\n", inputs[i]);
+		return(m_cost);
+	}
+
+private:
+
+	unsigned int getBytesPerPixel(Node * texture) const
+	{
+		std::map<const Node*, unsigned int>::const_iterator it = m_bytesPerPixel.find(texture);
+		return((it != m_bytesPerPixel.end()) ? it->second : 0);
+	}
+
+	const std::vector<ScheduledPass> & m_passes;
+	const std::map<const Node*, unsigned int> & m_bytesPerPixel;
+
+	const ScheduledPass * m_pPrevious;
+
+	std::map<Node*, unsigned int> m_remainingReaders;
+	std::map<Node*, unsigned int> m_remainingWriters;
+
+	std::set<Node*> m_live;
+	unsigned int m_liveBytes;
+
+	ScheduleCost m_cost;
+};
+
+/**
+ * @brief Append a node to an execution order, after the nodes it depends on (iterative post-order)
+ * @param graph
+ * @param root
+ * @param emitted (in/out) nodes already in the order
+ * @param order (in/out) execution order
+ */
+static void AppendWithDependencies(const Graph & graph, Node * root, std::set<const Node*> & emitted, std::vector<Node*> & order)
+{
+	std::vector<std::pair<Node*, bool>> stack; // node, inputs already pushed
+	stack.push_back(std::pair<Node*, bool>(root, false));
+
+	while (!stack.empty())
+	{
+		std::pair<Node*, bool> top = stack.back();
+		stack.pop_back();
+
+		if (emitted.find(top.first) != emitted.end())
+		{
+			continue;
+		}
+
+		if (top.second)
+		{
+			emitted.insert(top.first);
+			order.push_back(top.first);
+			continue;
+		}
+
+		stack.push_back(std::pair<Node*, bool>(top.first, true));
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(top.first, inEdges);
+
+		for (std::vector<Edge*>::reverse_iterator it = inEdges.rbegin(); it != inEdges.rend(); ++it)
+		{
+			if (emitted.find((*it)->getSource()) == emitted.end())
+			{
+				stack.push_back(std::pair<Node*, bool>((*it)->getSource(), false));
+			}
+		}
+	}
+}
+
+/**
+ * @brief Reorder independent passes to reduce state changes and render target memory
+ *
+ * List scheduling : among the passes whose dependencies already ran, run the cheapest one (framebuffer change, textures to bind,
+ * render target memory allocated minus released). Operators and textures are placed right before the first pass that needs them.
+ * The new order is only kept when its total cost is lower than the cost of the topological order.
+ *
+ * @param graph
+ * @param queue (in/out) nodes in reverse execution order (as returned by ApplyTopologicalOrdering)
+ * @param roots present node, or output nodes of a subgraph (they stay last)
+ * @param cost (output) cost of the selected order
+ */
+static void SchedulePasses(const Graph & graph, std::vector<Node*> & queue, const std::vector<Node*> & roots, ScheduleCost & cost)
+{
+	//
+	// Passes in the topological order, with the textures they read and write
+	std::vector<ScheduledPass> passes;
+	std::map<const Node*, unsigned int> mapPasses;
+	std::map<const Node*, unsigned int> bytesPerPixel;
+	std::vector<Node*> presented;
+
+	for (Node * root : roots)
+	{
+		std::vector<Edge*> edges;
+		graph.getEdgeTo(root, edges);
+
+		for (Edge * edge : edges)
+		{
+			presented.push_back(edge->getSource());
+		}
+	}
+
+	for (std::vector<Node*>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
+	{
+		Node * node = *it;
+
+		if (node->getType() == "texture")
+		{
+			bytesPerPixel[node] = RenderGraph::getBytesPerPixel(RenderGraph::strToFormat(node->getMetaData("format").c_str()));
+		}
+		else if (node->getType() == "pass")
+		{
+			ScheduledPass pass;
+			pass.node = node;
+
+			std::vector<Edge*> edges;
+
+			graph.getEdgeTo(node, edges);
+
+			for (Edge * edge : edges)
+			{
+				if (edge->getSource()->getType() == "texture" && std::find(pass.inputs.begin(), pass.inputs.end(), edge->getSource()) == pass.inputs.end())
+				{
+					pass.inputs.push_back(edge->getSource());
+				}
+			}
+
+			edges.clear();
+			graph.getEdgeFrom(node, edges);
+
+			for (Edge * edge : edges)
+			{
+				if (edge->getTarget()->getType() == "texture")
+				{
+					pass.outputs.push_back(edge->getTarget());
+				}
+			}
+
+			std::sort(pass.outputs.begin(), pass.outputs.end());
+			pass.outputs.erase(std::unique(pass.outputs.begin(), pass.outputs.end()), pass.outputs.end());
+
+			mapPasses[node] = passes.size();
+			passes.push_back(pass);
+		}
+	}
+
+	if (passes.size() < 2)
+	{
+		ScheduleSimulation simulation(passes, bytesPerPixel, presented);
+
+		for (unsigned int i = 0; i < passes.size(); ++i)
+		{
+			simulation.execute(i);
+		}
+
+		cost = simulation.getCost();
+		return;
+	}
+
+	//
+	// Cost of the topological order
+	ScheduleCost topologicalCost;
+
+	{
+		ScheduleSimulation simulation(passes, bytesPerPixel, presented);
+
+		for (unsigned int i = 0; i < passes.size(); ++i)
+		{
+			simulation.execute(i);
+		}
+
+		topologicalCost = simulation.getCost();
+	}
+
+	//
+	// List scheduling (ties are broken by the topological order, so the result is deterministic)
+	std::vector<unsigned int> order;
+	order.reserve(passes.size());
+
+	ScheduleCost scheduledCost;
+
+	{
+		ScheduleSimulation simulation(passes, bytesPerPixel, presented);
+
+		// a pass is ready when everything it reads is computed, operators and textures are computed as soon as their inputs are
+		const std::set<const Node*> setQueue(queue.begin(), queue.end());
+
+		std::map<const Node*, unsigned int> pending;
+		std::set<unsigned int> ready;
+
+		std::vector<Node*> completed;
+
+		for (Node * node : queue)
+		{
+			std::vector<Edge*> inEdges;
+			graph.getEdgeTo(node, inEdges);
+
+			pending[node] = inEdges.size();
+
+			if (inEdges.empty())
+			{
+				completed.push_back(node);
+			}
+		}
+
+		for (;;)
+		{
+			while (!completed.empty())
+			{
+				Node * node = completed.back();
+				completed.pop_back();
+
+				std::map<const Node*, unsigned int>::iterator itPass = mapPasses.find(node);
+
+				if (itPass != mapPasses.end() && pending[node] == 0)
+				{
+					pending[node] = ~0u; // ready, completed when it runs
+					ready.insert(itPass->second);
+					continue;
+				}
+
+				std::vector<Edge*> outEdges;
+				graph.getEdgeFrom(node, outEdges);
+
+				for (Edge * edge : outEdges)
+				{
+					Node * target = edge->getTarget();
+
+					if (setQueue.find(target) != setQueue.end() && --pending[target] == 0)
+					{
+						completed.push_back(target);
+					}
+				}
+			}
+
+			if (ready.empty())
+			{
+				break;
+			}
+
+			unsigned int best = *ready.begin();
+			int bestCost = simulation.evaluate(best);
+
+			for (unsigned int candidate : ready)
+			{
+				int candidateCost = simulation.evaluate(candidate);
+
+				if (candidateCost < bestCost)
+				{
+					best = candidate;
+					bestCost = candidateCost;
+				}
+			}
+
+			ready.erase(best);
+			simulation.execute(best);
+			order.push_back(best);
+
+			completed.push_back(passes[best].node);
+		}
+
+		assert(order.size() == passes.size());
+
+		scheduledCost = simulation.getCost();
+	}
+
+	const unsigned int topologicalTotal = topologicalCost.framebufferChanges * SCHEDULE_FRAMEBUFFER_CHANGE_COST + topologicalCost.textureBinds * SCHEDULE_TEXTURE_BIND_COST + topologicalCost.peakBytesPerPixel;
+	const unsigned int scheduledTotal = scheduledCost.framebufferChanges * SCHEDULE_FRAMEBUFFER_CHANGE_COST + scheduledCost.textureBinds * SCHEDULE_TEXTURE_BIND_COST + scheduledCost.peakBytesPerPixel;
+
+	if (scheduledTotal >= topologicalTotal)
+	{
+		cost = topologicalCost;
+		return;
+	}
+
+	//
+	// Rebuild the queue : every pass preceded by the nodes it needs that did not run yet
+	std::vector<Node*> execution;
+	execution.reserve(queue.size());
+
+	std::set<const Node*> emitted;
+
+	for (unsigned int index : order)
+	{
+		AppendWithDependencies(graph, passes[index].node, emitted, execution);
+	}
+
+	for (Node * root : roots)
+	{
+		std::vector<Edge*> edges;
+		graph.getEdgeTo(root, edges);
+
+		for (Edge * edge : edges)
+		{
+			AppendWithDependencies(graph, edge->getSource(), emitted, execution);
+		}
+	}
+
+	for (std::vector<Node*>::const_reverse_iterator it = roots.rbegin(); it != roots.rend(); ++it)
+	{
+		emitted.insert(*it);
+		execution.push_back(*it); // same order as ApplyTopologicalOrdering
+	}
+
+	assert(execution.size() == queue.size());
+
+	queue.assign(execution.rbegin(), execution.rend());
+
+	cost = scheduledCost;
+}
+
+/**
+ * @brief Allocate value slots for operator / pass outputs, reusing slots whose live ranges do not overlap
+ * @param graph
+ * @param queue nodes in reverse execution order (as returned by ApplyTopologicalOrdering)
+ * @param temporaries nodes producing temporary values (operators, passes and subgraphs)
+ * @param mapOutputCounts subgraph node -> number of outputs
+ * @param mapAliases duplicate node id -> canonical node id
+ * @param values (in/out) value memory, pinned slots (constants, subgraph inputs) must already be allocated
+ * @param mapValues (in/out) node id -> value slots
+ */
+static void AllocateTemporaryValues(const Graph & graph, const std::vector<Node*> & queue, const std::vector<Node*> & temporaries, const std::map<const Node*, unsigned int> & mapOutputCounts, const std::map<std::string, std::string> & mapAliases, std::vector<RenderGraph::Value> & values, std::map<std::string, std::vector<unsigned int>> & mapValues)
+{
+	const std::set<const Node*> setTemporaries(temporaries.begin(), temporaries.end());
+
+	const std::vector<Node*> order(queue.rbegin(), queue.rend());
+
+	//
+	// Live ranges : a temporary is defined when its node runs, and dies after its last consumer ran
+	std::map<std::string, std::vector<unsigned int>> mapLastUses;
+
+	for (unsigned int position = 0; position < order.size(); ++position)
+	{
+		Node * node = order[position];
+
+		if (setTemporaries.find(node) != setTemporaries.end() && mapAliases.find(node->getId()) == mapAliases.end())
+		{
+			std::vector<Edge*> outEdges;
+			graph.getEdgeFrom(node, outEdges);
+
+			unsigned int count = (node->getType() == "pass") ? outEdges.size() : 1; // operators have exactly 1 output
+
+			auto itCount = mapOutputCounts.find(node);
+
+			if (itCount != mapOutputCounts.end())
+			{
+				count = itCount->second;
+			}
+
+			mapLastUses[node->getId()].resize(count, position);
+		}
+	}
+
+	for (unsigned int position = 0; position < order.size(); ++position)
+	{
+		Node * node = order[position];
+
+		if (mapAliases.find(node->getId()) != mapAliases.end() || node->getType() == "texture" || node->getType() == "present")
+		{
+			continue; // no code is generated for this node
+		}
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		for (Edge * edge : inEdges)
+		{
+			std::string strId;
+			unsigned int outputParamIndex = 0;
+
+			if (ResolveValueSource(graph, edge, mapAliases, strId, outputParamIndex))
+			{
+				auto it = mapLastUses.find(strId);
+
+				if (it != mapLastUses.end() && outputParamIndex < it->second.size())
+				{
+					it->second[outputParamIndex] = std::max(it->second[outputParamIndex], position);
+				}
+			}
+		}
+	}
+
+	//
+	// Linear scan over the execution order
+	std::set<unsigned int> freeSlots;
+	std::vector<std::pair<unsigned int, unsigned int>> activeSlots; // (last use, slot)
+
+	for (unsigned int position = 0; position < order.size(); ++position)
+	{
+		Node * node = order[position];
+
+		auto itLastUses = mapLastUses.find(node->getId());
+
+		if (itLastUses == mapLastUses.end())
+		{
+			continue;
+		}
+
+		// Inputs are all pushed on the stack before outputs are popped : slots dying at this position can hold its outputs
+		for (std::vector<std::pair<unsigned int, unsigned int>>::iterator it = activeSlots.begin(); it != activeSlots.end();)
+		{
+			if (it->first <= position)
+			{
+				freeSlots.insert(it->second);
+				it = activeSlots.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		std::vector<unsigned int> outputs;
+
+		for (unsigned int lastUse : itLastUses->second)
+		{
+			unsigned int index = 0;
+
+			if (freeSlots.empty())
+			{
+				index = values.size();
+
+				RenderGraph::Value value;
+				value.asUInt = 0;
+				values.push_back(value);
+			}
+			else
+			{
+				index = *freeSlots.begin();
+				freeSlots.erase(freeSlots.begin());
+			}
+
+			outputs.push_back(index);
+
+			activeSlots.push_back(std::pair<unsigned int, unsigned int>(lastUse, index));
+		}
+
+		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(node->getId(), outputs));
+	}
+
+	//
+	// Duplicates share the slots of their canonical node
+	for (const std::pair<const std::string, std::string> & alias : mapAliases)
+	{
+		auto it = mapValues.find(alias.second);
+		assert(it != mapValues.end());
+
+		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(alias.first, it->second));
+	}
+}
+
+/**
+ * @brief Format and size of a texture node : metadata "scale" (relative to the instance, 1 by default), or "width" and "height" (fixed),
+ * "samples" (1 by default) and "levels" (mip levels, 1 by default)
+ * @param node
+ * @param layout (output)
+ * @return false if the size is invalid
+ */
+static bool ParseTextureLayout(const Node * node, RenderGraph::TextureLayout & layout)
+{
+	layout.format = RenderGraph::strToFormat(node->getMetaData("format").c_str());
+	layout.scale = 1.0f;
+	layout.width = 0;
+	layout.height = 0;
+	layout.samples = 1;
+	layout.levels = 1;
+	layout.resolve = false; // set when the texture is read (see generateProgram)
+
+	const std::string & strLevels = node->getMetaData("levels");
+
+	if (!strLevels.empty())
+	{
+		const int levels = atoi(strLevels.c_str());
+
+		if (levels < 1)
+		{
+			return(false);
+		}
+
+		layout.levels = levels;
+	}
+
+	const std::string & strSamples = node->getMetaData("samples");
+
+	if (!strSamples.empty())
+	{
+		const int samples = atoi(strSamples.c_str());
+
+		if (samples < 1)
+		{
+			return(false);
+		}
+
+		layout.samples = samples;
+	}
+
+	if (layout.samples > 1 && layout.levels > 1)
+	{
+		return(false); // multisample textures have no mip chain
+	}
+
+	const std::string & strScale = node->getMetaData("scale");
+	const std::string & strWidth = node->getMetaData("width");
+	const std::string & strHeight = node->getMetaData("height");
+
+	if (!strWidth.empty() || !strHeight.empty())
+	{
+		layout.width = atoi(strWidth.c_str());
+		layout.height = atoi(strHeight.c_str());
+
+		return(layout.width > 0 && layout.height > 0 && strScale.empty());
+	}
+
+	if (!strScale.empty())
+	{
+		layout.scale = float(atof(strScale.c_str()));
+
+		return(layout.scale > 0.0f);
+	}
+
+	return(true);
+}
+
+/**
+ * @brief Identity of a texture layout (textures with the same key are interchangeable)
+ * @param layout
+ * @return
+ */
+static std::string GetTextureKey(const RenderGraph::TextureLayout & layout)
+{
+	std::string key = std::to_string(layout.format) + ':';
+
+	if (layout.width > 0 && layout.height > 0)
+	{
+		key += std::to_string(layout.width) + 'x' + std::to_string(layout.height);
+	}
+	else
+	{
+		RenderGraph::Value scale;
+		scale.asFloat = layout.scale;
+
+		key += std::to_string(scale.asUInt);
+	}
+
+	if (layout.samples > 1)
+	{
+		key += '*' + std::to_string(layout.samples) + (layout.resolve ? "r" : "");
+	}
+
+	if (layout.levels > 1)
+	{
+		key += '#' + std::to_string(layout.levels);
+	}
+
+	return(key);
+}
+
+/**
+ * @brief Memory of a texture for each pixel of the instance (0 for a fixed size)
+ * @param layout
+ * @return
+ */
+static float GetBytesPerInstancePixel(const RenderGraph::TextureLayout & layout)
+{
+	if (layout.width > 0 && layout.height > 0)
+	{
+		return(0.0f);
+	}
+
+	return(float(RenderGraph::getBytesPerPixel(layout.format) * layout.samples) * layout.scale * layout.scale);
+}
+
+/**
+ * @brief Allocate texture slots, textures of the same format and size whose lifetimes do not overlap share a slot (and a GL texture)
+ *
+ * A texture lives from the first pass writing it to the last node reading it, over the execution order.
+ * Pinned textures (presented, returned by a subgraph) and textures no pass writes keep a slot of their own.
+ *
+ * @param graph
+ * @param queue nodes in reverse execution order (as returned by ApplyTopologicalOrdering)
+ * @param nodes texture nodes to allocate
+ * @param layouts texture node -> format and size
+ * @param pinned textures read after the last node ran
+ * @param textures (in/out) format and size of each slot
+ * @param mapTextures (in/out) node id -> slot
+ * @return render target memory saved by aliasing, in bytes per pixel of the instance (fixed-size textures are not counted)
+ */
+static unsigned int AllocateTextures(const Graph & graph, const std::vector<Node*> & queue, const std::vector<Node*> & nodes, const std::map<const Node*, RenderGraph::TextureLayout> & layouts, const std::set<const Node*> & pinned, std::vector<RenderGraph::TextureLayout> & textures, std::map<std::string, unsigned int> & mapTextures)
+{
+	const std::vector<Node*> order(queue.rbegin(), queue.rend());
+
+	//
+	// Live ranges
+	std::map<const Node*, std::pair<unsigned int, unsigned int>> mapLifetimes; // texture -> (first write, last use)
+
+	for (unsigned int position = 0; position < order.size(); ++position)
+	{
+		Node * node = order[position];
+
+		if (node->getType() == "texture")
+		{
+			continue;
+		}
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		for (Edge * edge : inEdges)
+		{
+			auto it = mapLifetimes.find(edge->getSource());
+
+			if (it != mapLifetimes.end())
+			{
+				it->second.second = std::max(it->second.second, position);
+			}
+		}
+
+		if (node->getType() != "pass")
+		{
+			continue;
+		}
+
+		std::vector<Edge*> outEdges;
+		graph.getEdgeFrom(node, outEdges);
+
+		for (Edge * edge : outEdges)
+		{
+			if (edge->getTarget()->getType() == "texture")
+			{
+				auto it = mapLifetimes.insert(std::pair<const Node*, std::pair<unsigned int, unsigned int>>(edge->getTarget(), std::pair<unsigned int, unsigned int>(position, position))).first;
+				it->second.second = std::max(it->second.second, position);
+			}
+		}
+	}
+
+	//
+	// Linear scan by first write
+	std::vector<std::pair<unsigned int, Node*>> aliased; // (first write, texture)
+	float totalBytesPerPixel = 0.0f;
+
+	for (Node * node : nodes)
+	{
+		const RenderGraph::TextureLayout & layout = layouts.at(node);
+
+		totalBytesPerPixel += GetBytesPerInstancePixel(layout);
+
+		auto it = mapLifetimes.find(node);
+
+		if (it == mapLifetimes.end() || pinned.find(node) != pinned.end())
+		{
+			mapTextures.insert(std::pair<std::string, unsigned int>(node->getId(), textures.size()));
+			textures.push_back(layout);
+		}
+		else
+		{
+			aliased.push_back(std::pair<unsigned int, Node*>(it->second.first, node));
+		}
+	}
+
+	std::stable_sort(aliased.begin(), aliased.end(), [](const std::pair<unsigned int, Node*> & a, const std::pair<unsigned int, Node*> & b)
+	{
+		return(a.first < b.first);
+	});
+
+	std::map<std::string, std::set<unsigned int>> freeSlots; // GetTextureKey -> slots
+	std::vector<std::pair<unsigned int, unsigned int>> activeSlots; // (last use, slot)
+
+	for (const std::pair<unsigned int, Node*> & texture : aliased)
+	{
+		// a pass can't read and write the same texture : slots read at this position are still in use
+		for (std::vector<std::pair<unsigned int, unsigned int>>::iterator it = activeSlots.begin(); it != activeSlots.end();)
+		{
+			if (it->first < texture.first)
+			{
+				freeSlots[GetTextureKey(textures[it->second])].insert(it->second);
+				it = activeSlots.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		const RenderGraph::TextureLayout & layout = layouts.at(texture.second);
+
+		std::set<unsigned int> & candidates = freeSlots[GetTextureKey(layout)];
+
+		unsigned int index = 0;
+
+		if (candidates.empty())
+		{
+			index = textures.size();
+			textures.push_back(layout);
+		}
+		else
+		{
+			index = *candidates.begin();
+			candidates.erase(candidates.begin());
+		}
+
+		mapTextures.insert(std::pair<std::string, unsigned int>(texture.second->getId(), index));
+
+		activeSlots.push_back(std::pair<unsigned int, unsigned int>(mapLifetimes[texture.second].second, index));
+	}
+
+	float allocatedBytesPerPixel = 0.0f;
+
+	for (const RenderGraph::TextureLayout & layout : textures)
+	{
+		allocatedBytesPerPixel += GetBytesPerInstancePixel(layout);
+	}
+
+	return(static_cast<unsigned int>(totalBytesPerPixel - allocatedBytesPerPixel + 0.5f));
+}
+
+/**
+ * @brief Report the time spent in a compile phase, and start timing the next one
+ * @param pDiagnostics
+ * @param phase
+ * @param start (in/out) start of the phase
+ */
+static inline void EndCompilePhase(RenderGraph::Diagnostics * pDiagnostics, RenderGraph::CompilePhase phase, std::chrono::steady_clock::time_point & start)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	if (pDiagnostics != nullptr)
+	{
+		pDiagnostics->onPhase(phase, std::chrono::duration<double>(end - start).count());
+	}
+
+	start = end;
+}
+
+/**
+ * @brief Decode bytecode and report each instruction
+ * @param bytecode
+ * @param pDiagnostics
+ */
+static void Disassemble(const std::vector<uint8_t> & bytecode, RenderGraph::Diagnostics * pDiagnostics)
+{
+	unsigned int offset = 0;
+
+	while (offset < bytecode.size())
+	{
+		RenderGraph::OpCode opcode = RenderGraph::OpCode(bytecode[offset]);
+
+		unsigned int size = RenderGraph::getOperandSize(opcode);
+		assert(offset + size < bytecode.size());
+
+		unsigned int operand = 0;
+
+		for (unsigned int i = 1; i <= size; ++i)
+		{
+			operand = (operand << 8) | bytecode[offset + i];
+		}
+
+		pDiagnostics->onInstruction(offset, opcode, operand);
+
+		offset += 1 + size;
+	}
+}
+
+static inline void genOperatorBytecode(RenderGraph::OpCode opcode, unsigned int numParams, const Graph & graph, Node * node, const std::map<std::string, std::vector<unsigned int>> & mapValues, std::vector<uint8_t> & bytecode)
+{
+	//
+	// Inputs
+	const std::vector<uint16_t> inputs = [&]
+	{
+		std::vector<uint16_t> values;
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		values.resize(numParams);
+
+		for (Edge * edge : inEdges)
+		{
+			Node * source = edge->getSource();
+
+			const std::string & strId = source->getId();
+
+			const std::string & source_id = edge->getMetaData("source_id");
+			int outputParamIndex = atoi(source_id.c_str());
+			assert(outputParamIndex < UINT8_MAX);
+
+			const std::string & target_id = edge->getMetaData("target_id");
+			int inputParamIndex = atoi(target_id.c_str());
+			assert(inputParamIndex < UINT8_MAX);
+
+			assert(source->getType() != "present" && source->getType() != "texture");
+			{
+				auto it = mapValues.find(strId);
+
+				if (it != mapValues.end())
+				{
+					unsigned int index = it->second[outputParamIndex];
+					uint16_t addr = (0 << 15) | (index & 0x7FFF);
+					values[inputParamIndex] = addr;
+				}
+				else
+				{
+					assert(false);
+				}
+			}
+		}
+
+		return values;
+	} ();
+
+	assert(inputs.size() == numParams);
+
+	//
+	// Output
+	uint16_t output = [&]
+	{
+		uint16_t value = 0;
+
+		auto it = mapValues.find(node->getId());
+
+		if (it != mapValues.end())
+		{
+			assert(it->second.size() == 1); // operators have exactly 1 output
+			unsigned int index = it->second[0];
+			uint16_t addr = (0 << 15) | (index & 0x7FFF);
+			value = addr;
+		}
+		else
+		{
+			assert(false);
+		}
+
+		return value;
+	} ();
+
+	//
+	// Gen bytecode
+	for (int i = 0; i < numParams; ++i)
+	{
+		bytecode.push_back(uint8_t(RenderGraph::OpCode::PUSH));
+		bytecode.push_back(uint8_t((inputs[i] >> 8) & 0xFF));
+		bytecode.push_back(uint8_t((inputs[i]) & 0xFF));
+	}
+
+	{
+		bytecode.push_back(uint8_t(opcode));
+
+		if (RenderGraph::getOperandSize(opcode) > 0)
+		{
+			bytecode.push_back(uint8_t(2)); // float
+		}
+	}
+
+	{
+		bytecode.push_back(uint8_t(RenderGraph::OpCode::POP));
+		bytecode.push_back(uint8_t((output >> 8) & 0xFF));
+		bytecode.push_back(uint8_t((output) & 0xFF));
+	}
+}
+
+static inline void genOperationBytecode(const std::map<std::string, unsigned int> & mapOperations, const std::map<std::string, unsigned int> & mapTextures, const Graph & graph, Node * node, const std::map<std::string, std::vector<unsigned int>> & mapValues, std::vector<uint8_t> & bytecode, RenderGraph::OpCode opcode)
+{
+	//
+	// Inputs
+	const std::vector<uint16_t> inputs = [&]
+	{
+		std::vector<uint16_t> values;
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		values.resize(inEdges.size());
+
+		for (Edge * edge : inEdges)
+		{
+			Node * source = edge->getSource();
+
+			const std::string & strId = source->getId();
+
+			const std::string & source_id = edge->getMetaData("source_id");
+			int outputParamIndex = atoi(source_id.c_str());
+			assert(outputParamIndex < UINT8_MAX);
+
+			const std::string & target_id = edge->getMetaData("target_id");
+			int inputParamIndex = atoi(target_id.c_str());
+			assert(inputParamIndex < UINT8_MAX);
+
+			if (source->getType() == "texture")
+			{
+				std::vector<Edge*> inEdges2;
+				graph.getEdgeTo(source, inEdges2);
+
+				if (inEdges2.size() > 0)
+				{
+					Edge * edge2 = inEdges2[0];
+
+					Node * source2 = edge2->getSource();
+
+					const std::string & strId = source2->getId();
+
+					const std::string & source_id = edge2->getMetaData("source_id");
+					int outputParamIndex = atoi(source_id.c_str());
+					assert(outputParamIndex < UINT8_MAX);
+
+					assert(source2->getType() != "present" && source2->getType() != "texture");
+
+					auto it = mapValues.find(strId);
+
+					if (it != mapValues.end())
+					{
+						unsigned int index = it->second[outputParamIndex];
+						uint16_t addr = (0 << 15) | (index & 0x7FFF);
+						values[inputParamIndex] = addr;
+					}
+					else
+					{
+						assert(false);
+					}
+				}
+			}
+			else
+			{
+				assert(source->getType() != "present" && source->getType() != "texture");
+
+				auto it = mapValues.find(strId);
+
+				if (it != mapValues.end())
+				{
+					unsigned int index = it->second[outputParamIndex];
+					uint16_t addr = (0 << 15) | (index & 0x7FFF);
+					values[inputParamIndex] = addr;
+				}
+				else
+				{
+					assert(false);
+				}
+			}
+		}
+
+		return values;
+	} ();
+
+	assert(inputs.size() < UINT8_MAX);
+
+	//
+	// Outputs
+	const std::vector<uint16_t> outputs = [&]
+	{
+		std::vector<uint16_t> values;
+
+		std::vector<Edge*> outEdges;
+		graph.getEdgeFrom(node, outEdges);
+
+		values.resize(outEdges.size());
+
+		for (Edge * edge : outEdges)
+		{
+			Node * target = edge->getTarget();
+
+			const std::string & strId = target->getId();
+
+			const std::string & source_id = edge->getMetaData("source_id");
+			int outputParamIndex = atoi(source_id.c_str());
+			assert(outputParamIndex < UINT8_MAX);
+
+			const std::string & target_id = edge->getMetaData("target_id");
+			int inputParamIndex = atoi(target_id.c_str());
+			assert(inputParamIndex < UINT8_MAX);
+
+			auto it = mapValues.find(node->getId());
+
+			if (it != mapValues.end())
+			{
+				unsigned int index = it->second[outputParamIndex];
+				uint16_t addr = (0 << 15) | (index & 0x7FFF);
+				values[values.size() - 1 - outputParamIndex] = addr; // pop in reverse order
+			}
+			else
+			{
+				assert(false);
+			}
+		}
+
+		return values;
+	} ();
+
+	assert(outputs.size() < UINT8_MAX);
+
+	//
+	// Gen bytecode
+	for (int i = 0; i < inputs.size(); ++i)
+	{
+		bytecode.push_back(uint8_t(RenderGraph::OpCode::PUSH));
+		bytecode.push_back(uint8_t((inputs[i] >> 8) & 0xFF));
+		bytecode.push_back(uint8_t((inputs[i]) & 0xFF));
 	}
 
 	{
 		auto it = mapOperations.find(node->getId());
 
-		if (it != mapOperations.end())
+		if (it != mapOperations.end())
+		{
+			unsigned int index = it->second;
+			uint16_t addr = (index & 0xFFFF);
+
+			bytecode.push_back(uint8_t(opcode)); // CALL, or DRAW inside a render pass scope
+			bytecode.push_back(uint8_t((addr >> 8) & 0xFF));
+			bytecode.push_back(uint8_t((addr) & 0xFF));
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	for (int i = 0; i < outputs.size(); ++i)
+	{
+		bytecode.push_back(uint8_t(RenderGraph::OpCode::POP));
+		bytecode.push_back(uint8_t((outputs[i] >> 8) & 0xFF));
+		bytecode.push_back(uint8_t((outputs[i]) & 0xFF));
+	}
+}
+
+/**
+ * @brief Begin / resume / end a render pass scope
+ * @param opcode BEGIN, RESUME or END
+ * @param mapOperations
+ * @param node pass
+ * @param bytecode
+ */
+static inline void genPassScopeBytecode(RenderGraph::OpCode opcode, const std::map<std::string, unsigned int> & mapOperations, Node * node, std::vector<uint8_t> & bytecode)
+{
+	auto it = mapOperations.find(node->getId());
+
+	if (it != mapOperations.end())
+	{
+		uint16_t addr = (it->second & 0xFFFF);
+
+		bytecode.push_back(uint8_t(opcode));
+		bytecode.push_back(uint8_t((addr >> 8) & 0xFF));
+		bytecode.push_back(uint8_t((addr) & 0xFF));
+	}
+	else
+	{
+		assert(false);
+	}
+}
+
+/**
+ * @brief Generate the bytecode resolving the multisample textures a pass rendered, when they are read afterwards
+ * @param mapTextures
+ * @param setResolved multisample textures read after they are rendered
+ * @param graph
+ * @param node pass (the last one of its render pass scope)
+ * @param bytecode
+ */
+static inline void genResolveBytecode(const std::map<std::string, unsigned int> & mapTextures, const std::set<const Node*> & setResolved, const Graph & graph, Node * node, std::vector<uint8_t> & bytecode)
+{
+	std::vector<Edge*> outEdges;
+	graph.getEdgeFrom(node, outEdges);
+
+	for (Edge * edge : outEdges)
+	{
+		const Node * target = edge->getTarget();
+
+		if (setResolved.find(target) == setResolved.end())
+		{
+			continue;
+		}
+
+		auto it = mapTextures.find(target->getId());
+
+		if (it != mapTextures.end())
+		{
+			uint16_t addr = (it->second & 0xFFFF);
+
+			bytecode.push_back(uint8_t(RenderGraph::OpCode::RESOLVE));
+			bytecode.push_back(uint8_t((addr >> 8) & 0xFF));
+			bytecode.push_back(uint8_t((addr) & 0xFF));
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+}
+
+/**
+ * @brief Hash a graph in a canonical form, and the subgraphs it uses
+ * @param hash (in/out)
+ * @param graph
+ * @param files (in/out) subgraph files already hashed
+ */
+static void HashGraph(RenderGraph::Hash & hash, const Graph & graph, std::set<std::string> & files)
+{
+	//
+	// Canonical graph : nodes and edges sorted, only the metadata read by the compiler
+	std::vector<std::string> nodes;
+	nodes.reserve(graph.getNodes().size());
+
+	for (Node * node : graph.getNodes())
+	{
+		std::string str = node->getId() + '\x1F' + node->getType();
+
+		for (const char * key : COMPILER_NODE_METADATA)
+		{
+			str += '\x1F';
+			str += node->getMetaData(key);
+		}
+
+		nodes.push_back(str);
+	}
+
+	std::sort(nodes.begin(), nodes.end());
+
+	std::vector<std::string> edges;
+	edges.reserve(graph.getEdges().size());
+
+	for (Edge * edge : graph.getEdges())
+	{
+		std::string str = edge->getSource()->getId() + '\x1F' + edge->getTarget()->getId();
+
+		for (const char * key : COMPILER_EDGE_METADATA)
+		{
+			str += '\x1F';
+			str += edge->getMetaData(key);
+		}
+
+		edges.push_back(str);
+	}
+
+	std::sort(edges.begin(), edges.end());
+
+	for (const std::string & str : nodes)
+	{
+		hash.update(str);
+	}
+
+	for (const std::string & str : edges)
+	{
+		hash.update(str);
+	}
+
+	//
+	// Subgraphs are compiled into the program : their content is part of the key
+	std::set<std::string> subgraphs;
+
+	for (Node * node : graph.getNodes())
+	{
+		if (node->getType() == "subgraph")
+		{
+			subgraphs.insert(node->getMetaData("graph"));
+		}
+	}
+
+	for (const std::string & path : subgraphs)
+	{
+		if (!files.insert(path).second)
+		{
+			continue; // already hashed (or recursion, which fails to compile anyway)
+		}
+
+		Graph subgraph;
+
+		hash.update(path);
+
+		if (subgraph.loadFromFile(path.c_str()))
+		{
+			HashGraph(hash, subgraph, files);
+		}
+	}
+
+}
+
+/**
+ * @brief Emit an instruction with a 16 bits operand
+ * @param opcode
+ * @param operand
+ * @param bytecode
+ */
+static inline void genInstructionBytecode(RenderGraph::OpCode opcode, uint16_t operand, std::vector<uint8_t> & bytecode)
+{
+	bytecode.push_back(uint8_t(opcode));
+	bytecode.push_back(uint8_t((operand >> 8) & 0xFF));
+	bytecode.push_back(uint8_t((operand) & 0xFF));
+}
+
+/**
+ * @brief Sort the input / output nodes of a subgraph by parameter index
+ * @param nodes (in/out)
+ * @return false if the indices are not 0, 1, ... N-1
+ */
+static bool SortParameters(std::vector<Node*> & nodes)
+{
+	std::sort(nodes.begin(), nodes.end(), [](Node * a, Node * b)
+	{
+		return(atoi(a->getMetaData("index").c_str()) < atoi(b->getMetaData("index").c_str()));
+	});
+
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		if (nodes[i]->getMetaData("index") != std::to_string(i))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/**
+ * @brief Invoke a subgraph : push its inputs, run its code with the resources of this use site, pop its outputs
+ * @param graph
+ * @param node subgraph node
+ * @param site index of the use site (operand of INVOKE)
+ * @param subgraph compiled subgraph
+ * @param mapAliases duplicate node id -> canonical node id
+ * @param mapValues
+ * @param bytecode
+ * @return false if the inputs do not match the parameters of the subgraph
+ */
+static bool genInvocationBytecode(const Graph & graph, Node * node, unsigned int site, const RenderGraph::Program & subgraph, const std::map<std::string, std::string> & mapAliases, const std::map<std::string, std::vector<unsigned int>> & mapValues, std::vector<uint8_t> & bytecode)
+{
+	std::vector<Edge*> inEdges;
+	graph.getEdgeTo(node, inEdges);
+
+	if (inEdges.size() != subgraph.inputs)
+	{
+		return(false);
+	}
+
+	std::vector<uint16_t> inputs(subgraph.inputs, 0xFFFF);
+
+	for (Edge * edge : inEdges)
+	{
+		unsigned int inputParamIndex = atoi(edge->getMetaData("target_id").c_str());
+
+		std::string strId;
+		unsigned int outputParamIndex = 0;
+
+		if (inputParamIndex >= inputs.size() || inputs[inputParamIndex] != 0xFFFF || !ResolveValueSource(graph, edge, mapAliases, strId, outputParamIndex))
+		{
+			return(false);
+		}
+
+		auto it = mapValues.find(strId);
+
+		if (it == mapValues.end() || outputParamIndex >= it->second.size())
+		{
+			return(false);
+		}
+
+		inputs[inputParamIndex] = (0 << 15) | (it->second[outputParamIndex] & 0x7FFF);
+	}
+
+	auto it = mapValues.find(node->getId());
+
+	if (it == mapValues.end() || it->second.size() != subgraph.outputs)
+	{
+		assert(false);
+		return(false);
+	}
+
+	for (uint16_t addr : inputs)
+	{
+		genInstructionBytecode(RenderGraph::OpCode::PUSH, addr, bytecode);
+	}
+
+	genInstructionBytecode(RenderGraph::OpCode::INVOKE, uint16_t(site), bytecode);
+
+	for (std::vector<unsigned int>::const_reverse_iterator itOutput = it->second.rbegin(); itOutput != it->second.rend(); ++itOutput)
+	{
+		genInstructionBytecode(RenderGraph::OpCode::POP, (0 << 15) | (*itOutput & 0x7FFF), bytecode); // pop in reverse order
+	}
+
+	return(true);
+}
+
+/**
+ * @brief Append the code of the subgraphs after the code of a program, and the resources of every use site to its resources
+ *
+ * The code of a subgraph is appended once, whatever the number of use sites : resource addresses in its code are relative
+ * to the bases of the invocation (see InvocationLayout), so each use site only adds a copy of the subgraph resources.
+ * Resources of a use site are named "<subgraph node id>/<node id in the subgraph>".
+ *
+ * @param program (in/out) program of the graph, invocations must be empty
+ * @param sites subgraph node id, compiled subgraph (in the order of the INVOKE operands)
+ * @return
+ */
+static bool LinkSubgraphs(RenderGraph::Program & program, const std::vector<std::pair<std::string, const RenderGraph::Program*>> & sites)
+{
+	assert(program.invocations.empty());
+
+	program.invocations.resize(sites.size());
+
+	//
+	// Code of each subgraph (relocated : the invocations of nested subgraphs and the jumps)
+	std::map<const RenderGraph::Program*, unsigned int> mapEntries;
+
+	for (const std::pair<std::string, const RenderGraph::Program*> & site : sites)
+	{
+		const RenderGraph::Program & subgraph = *site.second;
+
+		if (mapEntries.find(&subgraph) != mapEntries.end())
+		{
+			continue;
+		}
+
+		const unsigned int entry = program.bytecode.size();
+		const unsigned int invocationBase = program.invocations.size();
+
+		if (invocationBase + subgraph.invocations.size() > 0x10000)
+		{
+			return(false); // operands are 16 bits
+		}
+
+		mapEntries[&subgraph] = entry;
+
+		unsigned int offset = 0;
+
+		while (offset < subgraph.bytecode.size())
+		{
+			RenderGraph::OpCode opcode = RenderGraph::OpCode(subgraph.bytecode[offset]);
+
+			unsigned int size = RenderGraph::getOperandSize(opcode);
+			assert(offset + size < subgraph.bytecode.size());
+
+			if (opcode == RenderGraph::OpCode::INVOKE || opcode == RenderGraph::OpCode::JMP || opcode == RenderGraph::OpCode::JMPT || opcode == RenderGraph::OpCode::JMPF)
+			{
+				unsigned int operand = (subgraph.bytecode[offset + 1] << 8) | subgraph.bytecode[offset + 2];
+				operand += (opcode == RenderGraph::OpCode::INVOKE) ? invocationBase : entry;
+
+				if (operand > 0xFFFF)
+				{
+					return(false); // operands are 16 bits
+				}
+
+				genInstructionBytecode(opcode, uint16_t(operand), program.bytecode);
+			}
+			else
+			{
+				program.bytecode.insert(program.bytecode.end(), subgraph.bytecode.begin() + offset, subgraph.bytecode.begin() + offset + 1 + size);
+			}
+
+			offset += 1 + size;
+		}
+
+		for (RenderGraph::InvocationLayout invocation : subgraph.invocations)
+		{
+			invocation.entry += entry;
+			program.invocations.push_back(invocation);
+		}
+	}
+
+	//
+	// Resources of each use site
+	for (unsigned int i = 0; i < sites.size(); ++i)
+	{
+		const std::string & strSiteId = sites[i].first;
+		const RenderGraph::Program & subgraph = *sites[i].second;
+
+		RenderGraph::InvocationLayout & invocation = program.invocations[i];
+		invocation.entry = mapEntries[&subgraph];
+		invocation.values = program.values.size();
+		invocation.textures = program.textures.size();
+		invocation.operations = program.operations.size();
+
+		program.values.insert(program.values.end(), subgraph.values.begin(), subgraph.values.end());
+		program.textures.insert(program.textures.end(), subgraph.textures.begin(), subgraph.textures.end());
+
+		for (RenderGraph::OperationLayout operation : subgraph.operations)
+		{
+			operation.id = strSiteId + '/' + operation.id;
+			program.operations.push_back(operation);
+		}
+
+		for (RenderGraph::FramebufferLayout framebuffer : subgraph.framebuffers)
+		{
+			for (unsigned int & texture : framebuffer.textures)
+			{
+				texture += invocation.textures;
+			}
+
+			framebuffer.operation += invocation.operations;
+			program.framebuffers.push_back(framebuffer);
+		}
+
+		for (const std::pair<const std::string, unsigned int> & slot : subgraph.textureSlots)
+		{
+			program.textureSlots.insert(std::pair<std::string, unsigned int>(strSiteId + '/' + slot.first, slot.second + invocation.textures));
+		}
+
+		for (const std::pair<const std::string, std::vector<unsigned int>> & slot : subgraph.valueSlots)
+		{
+			std::vector<unsigned int> indices = slot.second;
+
+			for (unsigned int & index : indices)
+			{
+				index += invocation.values;
+			}
+
+			program.valueSlots.insert(std::pair<std::string, std::vector<unsigned int>>(strSiteId + '/' + slot.first, indices));
+		}
+	}
+
+	return(program.values.size() <= 0x8000 && program.textures.size() <= 0x8000 && program.operations.size() <= 0x10000);
+}
+
+/**
+ * @brief Check that every output of a program is rendered by passes of the program
+ * @param program
+ * @return
+ */
+static bool CheckPresents(const RenderGraph::Program & program)
+{
+	if (program.presents.empty())
+	{
+		return(false);
+	}
+
+	for (const RenderGraph::PresentLayout & present : program.presents)
+	{
+		if (!program.useDefaultFramebuffer && present.framebuffer >= program.framebuffers.size())
+		{
+			return(false);
+		}
+
+		for (unsigned int operation : present.operations)
+		{
+			if (operation >= program.operations.size())
+			{
+				return(false);
+			}
+		}
+	}
+
+	return(true);
+}
+
+/**
+ * @brief Identity of each operation of a program : two variants share an operation when the keys are equal
+ * @param program
+ * @param textureIds node id of each texture of the program
+ * @return node id, subtype, signature and attachments (texture id and format) of each operation
+ */
+static std::vector<std::string> GetOperationKeys(const RenderGraph::Program & program, const std::vector<std::string> & textureIds)
+{
+	std::vector<std::string> keys;
+	keys.reserve(program.operations.size());
+
+	for (const RenderGraph::OperationLayout & layout : program.operations)
+	{
+		keys.push_back(layout.id + '\x1F' + layout.subtype + '\x1F' + std::to_string(layout.inputs) + '\x1F' + std::to_string(layout.outputs));
+	}
+
+	for (const RenderGraph::FramebufferLayout & framebuffer : program.framebuffers)
+	{
+		for (unsigned int i = 0; i < framebuffer.textures.size(); ++i)
+		{
+			const unsigned int texture = framebuffer.textures[i];
+
+			keys[framebuffer.operation] += '\x1F' + textureIds[texture] + ':' + GetTextureKey(program.textures[texture]) + '@' + std::to_string(framebuffer.levels[i]);
+		}
+	}
+
+	for (const RenderGraph::PresentLayout & present : program.presents)
+	{
+		for (unsigned int operation : present.operations)
+		{
+			keys[operation] += '\x1F' + present.name; // output framebuffer of the application
+		}
+	}
+
+	return(keys);
+}
+
+/**
+ * @brief Node id of each texture of a program
+ * @param program
+ * @return
+ */
+static std::vector<std::string> GetTextureIds(const RenderGraph::Program & program)
+{
+	std::vector<std::string> ids(program.textures.size());
+
+	for (const std::pair<const std::string, unsigned int> & slot : program.textureSlots)
+	{
+		if (ids[slot.second].empty())
+		{
+			ids[slot.second] = slot.first; // aliased textures are identified by the first id (in sorted order)
+		}
+	}
+
+	return(ids);
+}
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Graph compiled in the background by Factory::reloadInstance
+ */
+struct ReloadTask
+{
+	ReloadTask(void) : done(false), success(false)
+	{
+		// ...
+	}
+
+	std::thread thread;
+	std::atomic<bool> done;
+	bool success; // written before done
+	Program program;
+};
+
+/**
+ * @brief Subgraphs compiled while compiling a graph
+ */
+struct SubgraphContext
+{
+	std::map<std::string, Program> programs; // graph file -> compiled subgraph
+	std::vector<std::string> stack; // graph files being compiled (a subgraph can't use itself)
+};
+
+/**
+ * @brief Default constructor
+ */
+Factory::Factory(void) : m_pDiagnostics(nullptr), m_pInitScheduler(nullptr), m_pTexturePool(std::make_shared<TexturePool>()), m_pFramebufferCache(std::make_shared<FramebufferCache>())
+{
+	// ...
+}
+
+/**
+ * @brief Destructor
+ */
+Factory::~Factory(void)
+{
+	for (std::pair<const Instance * const, std::shared_ptr<ReloadTask>> & reload : m_reloads)
+	{
+		reload.second->thread.join();
+	}
+
+	destroyRetiredOperations(m_aRetiredOperations);
+
+	assert(m_aRetiredOperations.empty()); // the InitScheduler must finish its work before the Factory is destroyed
+}
+
+/**
+ * @brief Factory::createInstanceFromGraph
+ * @param graph
+ * @return
+ */
+Instance * Factory::createInstanceFromGraph(const Graph & graph) const
+{
+	std::map<std::string, unsigned int> mapTextures;
+	std::map<std::string, std::vector<unsigned int>> mapValues;
+
+	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, false);
+
+	assert(pInstance != nullptr);
+
+	return pInstance;
+}
+
+/**
+ * @brief Factory::createInstanceFromGraph
+ * @param graph
+ * @return
+ */
+Instance * Factory::createInstanceFromGraph(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const
+{
+	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, false);
+
+	assert(pInstance != nullptr);
+
+	return pInstance;
+}
+
+/**
+ * @brief Factory::createInstanceFromGraph
+ * @param graph
+ * @param defaultFramebuffer
+ * @return
+ */
+Instance * Factory::createInstanceFromGraph(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer) const
+{
+	std::map<std::string, unsigned int> mapTextures;
+	std::map<std::string, std::vector<unsigned int>> mapValues;
+
+	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, true, defaultFramebuffer);
+
+	assert(pInstance != nullptr);
+
+	return pInstance;
+}
+
+/**
+ * @brief Factory::createInstanceFromGraph
+ * @param graph
+ * @param defaultFramebuffer
+ * @return
+ */
+Instance * Factory::createInstanceFromGraph(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const
+{
+	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, true, defaultFramebuffer);
+
+	assert(pInstance != nullptr);
+
+	return pInstance;
+}
+
+/**
+ * @brief Factory::createInstanceFromGraph
+ * @param graph
+ * @return
+ */
+Instance * Factory::createInstanceFromGraph(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer) const
+{
+	mapTextures.clear();
+	mapValues.clear();
+
+	Program program;
+
+	if (!compileGraph(graph, program, bUseDefaultFramebuffer))
+	{
+		return(nullptr);
+	}
+
+	mapTextures = program.textureSlots;
+	mapValues = program.valueSlots;
+
+	return(createInstanceFromProgram(std::make_shared<const Program>(std::move(program)), bUseDefaultFramebuffer, defaultFramebuffer));
+}
+
+/**
+ * @brief Compile a graph (does not create any GL resource), or load it from the cache
+ * @param graph
+ * @param program (output)
+ * @param bUseDefaultFramebuffer the final pass renders into a framebuffer provided when creating the instance
+ * @return
+ */
+bool Factory::compileGraph(const Graph & graph, Program & program, bool bUseDefaultFramebuffer) const
+{
+	std::shared_ptr<ProgramCache> cache;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		cache = m_cache;
+	}
+
+	if (!cache)
+	{
+		return(generateProgram(graph, program, bUseDefaultFramebuffer));
+	}
+
+	const uint64_t key = computeCacheKey(graph, bUseDefaultFramebuffer);
+
+	if (cache->load(key, program))
+	{
+		return(true);
+	}
+
+	if (!generateProgram(graph, program, bUseDefaultFramebuffer))
+	{
+		return(false);
+	}
+
+	cache->store(key, program);
+
+	return(true);
+}
+
+/**
+ * @brief Compile a graph into a program that instances can share
+ * @param graph
+ * @param program (output)
+ * @param bUseDefaultFramebuffer
+ * @return
+ */
+bool Factory::compileGraph(const Graph & graph, SharedProgram & program, bool bUseDefaultFramebuffer) const
+{
+	Program compiled;
+
+	if (!compileGraph(graph, compiled, bUseDefaultFramebuffer))
+	{
+		return(false);
+	}
+
+	program = std::make_shared<const Program>(std::move(compiled));
+
+	return(true);
+}
+
+/**
+ * @brief Compile several graphs concurrently (does not create any GL resource)
+ * @param graphs
+ * @param programs (output) one program per graph
+ * @param threadCount number of threads compiling (0 : one per hardware thread)
+ * @param bUseDefaultFramebuffer
+ * @return false if at least one graph could not be compiled
+ */
+bool Factory::compileGraphs(const std::vector<const Graph*> & graphs, std::vector<Program> & programs, unsigned int threadCount, bool bUseDefaultFramebuffer) const
+{
+	programs.clear();
+	programs.resize(graphs.size());
+
+	std::vector<uint8_t> results(graphs.size(), 0);
+
+	std::atomic<unsigned int> next(0);
+
+	auto worker = [&] (void)
+	{
+		for (unsigned int i = next++; i < graphs.size(); i = next++)
+		{
+			results[i] = compileGraph(*graphs[i], programs[i], bUseDefaultFramebuffer) ? 1 : 0;
+		}
+	};
+
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	threadCount = std::min<unsigned int>(threadCount, graphs.size());
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		threads.push_back(std::thread(worker));
+	}
+
+	worker(); // the calling thread compiles too
+
+	for (std::thread & thread : threads)
+	{
+		thread.join();
+	}
+
+	return(std::find(results.begin(), results.end(), 0) == results.end());
+}
+
+/**
+ * @brief Hash everything the compiled program depends on : graph content (subgraphs included), registered operations and library version
+ * @param graph
+ * @param bUseDefaultFramebuffer
+ * @return
+ */
+uint64_t Factory::computeCacheKey(const Graph & graph, bool bUseDefaultFramebuffer) const
+{
+	Hash hash;
+
+	hash.update(RENDER_GRAPH_VERSION);
+
+	const uint32_t version = RENDER_GRAPH_PROGRAM_VERSION;
+	hash.update(&version, sizeof(version));
+
+	const uint8_t mode = bUseDefaultFramebuffer ? 1 : 0;
+	hash.update(&mode, sizeof(mode));
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (const std::pair<const std::string, OperationFactory> & entry : m_factories)
+		{
+			hash.update(entry.first);
+		}
+	}
+
+	std::set<std::string> files;
+
+	HashGraph(hash, graph, files);
+
+	return(hash.get());
+}
+
+/**
+ * @brief Compile a graph (does not create any GL resource)
+ * @param graph
+ * @param program (output)
+ * @param bUseDefaultFramebuffer the final pass renders into a framebuffer provided when creating the instance
+ * @return
+ */
+bool Factory::generateProgram(const Graph & graph, Program & program, bool bUseDefaultFramebuffer) const
+{
+	SubgraphContext context;
+
+	return(generateProgram(graph, program, bUseDefaultFramebuffer, context));
+}
+
+/**
+ * @brief Compile a subgraph file, unless it was already compiled during this compilation
+ * @param path graph file
+ * @param context (in/out)
+ * @return nullptr if the file can't be loaded / compiled, or if it uses itself
+ */
+const Program * Factory::generateSubgraph(const std::string & path, SubgraphContext & context) const
+{
+	std::map<std::string, Program>::const_iterator it = context.programs.find(path);
+
+	if (it != context.programs.end())
+	{
+		return(&it->second);
+	}
+
+	if (std::find(context.stack.begin(), context.stack.end(), path) != context.stack.end())
+	{
+		return(nullptr); // recursion
+	}
+
+	Graph graph;
+
+	if (!graph.loadFromFile(path.c_str()))
+	{
+		return(nullptr);
+	}
+
+	Program program;
+
+	context.stack.push_back(path);
+
+	bool success = generateProgram(graph, program, false, context);
+
+	context.stack.pop_back();
+
+	if (!success || program.outputs == 0)
+	{
+		return(nullptr); // not a subgraph (or a broken one)
+	}
+
+	return(&context.programs.insert(std::pair<std::string, Program>(path, program)).first->second);
+}
+
+/**
+ * @brief Compile a graph, or a subgraph (a graph with output nodes instead of a present node)
+ * @param graph
+ * @param program (output)
+ * @param bUseDefaultFramebuffer
+ * @param context (in/out) subgraphs already compiled
+ * @return
+ */
+bool Factory::generateProgram(const Graph & graph, Program & program, bool bUseDefaultFramebuffer, SubgraphContext & context) const
+{
+	program.clear();
+	program.useDefaultFramebuffer = bUseDefaultFramebuffer;
+
+	Diagnostics * pDiagnostics = context.stack.empty() ? m_pDiagnostics.load() : nullptr; // only report the graph itself
+
+	std::map<std::string, unsigned int> & mapTextures = program.textureSlots;
+	std::map<std::string, std::vector<unsigned int>> & mapValues = program.valueSlots;
+
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+
+	std::vector<Node*> aNodesPresent;
+	std::vector<Node*> aNodesTexture;
+	std::vector<Node*> aNodesFloat;
+	std::vector<Node*> aNodesPass;
+	std::vector<Node*> aNodesOperator;
+	std::vector<Node*> aNodesSubgraph;
+	std::vector<Node*> aNodesInput;
+	std::vector<Node*> aNodesOutput;
+
+	for (Node * node : graph.getNodes())
+	{
+		if (node->getType() == "present")
+		{
+			aNodesPresent.push_back(node);
+		}
+		else if (node->getType() == "subgraph")
+		{
+			aNodesSubgraph.push_back(node);
+		}
+		else if (node->getType() == "input")
+		{
+			aNodesInput.push_back(node);
+		}
+		else if (node->getType() == "output")
+		{
+			aNodesOutput.push_back(node);
+		}
+		else if (node->getType() == "texture")
+		{
+			aNodesTexture.push_back(node);
+		}
+		else if (node->getType() == "pass")
+		{
+			aNodesPass.push_back(node);
+		}
+		else if (node->getType() == "float")
+		{
+			aNodesFloat.push_back(node);
+		}
+		else if (node->getType() == "addition")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "subtraction")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "multiplication")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "division")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "negation")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "absolute")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "equal_to")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "not_equal_to")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "greater_than")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "greater_than_or_equal_to")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "less_than")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "less_than_or_equal_to")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "not")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "and")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else if (node->getType() == "or")
+		{
+			aNodesOperator.push_back(node);
+		}
+		else
+		{
+			assert(false);
+		}
+	}
+
+	// A graph presents textures, a subgraph returns its outputs to the graph using it
+	const bool bSubgraph = aNodesPresent.empty();
+
+	if (bSubgraph && (aNodesOutput.empty() || bUseDefaultFramebuffer))
+	{
+		assert(false);
+		return(false);
+	}
+
+	if (!bSubgraph && (!aNodesInput.empty() || !aNodesOutput.empty()))
+	{
+		return(false);
+	}
+
+	if (!SortParameters(aNodesInput) || !SortParameters(aNodesOutput))
+	{
+		return(false);
+	}
+
+	program.inputs = aNodesInput.size();
+	program.outputs = aNodesOutput.size();
+
+	// Outputs are sorted by name, the first one is the default framebuffer
+	std::sort(aNodesPresent.begin(), aNodesPresent.end(), [](Node * a, Node * b)
+	{
+		return(a->getId() < b->getId());
+	});
+
+	const std::vector<Node*> roots = bSubgraph ? aNodesOutput : aNodesPresent;
+
+	//
+	// Subgraphs used by this graph, each file is compiled once
+	std::vector<std::pair<std::string, const Program*>> subgraphs; // (node id, program) in the order of aNodesSubgraph
+	std::map<const Node*, unsigned int> mapSites; // subgraph node -> index in subgraphs
+	std::map<const Node*, unsigned int> mapOutputCounts;
+
+	for (Node * node : aNodesSubgraph)
+	{
+		const Program * pSubgraph = generateSubgraph(node->getMetaData("graph"), context);
+
+		if (nullptr == pSubgraph)
+		{
+			return(false);
+		}
+
+		mapSites[node] = subgraphs.size();
+		subgraphs.push_back(std::pair<std::string, const Program*>(node->getId(), pSubgraph));
+		mapOutputCounts[node] = pSubgraph->outputs;
+	}
+
+	EndCompilePhase(pDiagnostics, CompilePhase::CLASSIFY, phaseStart);
+
+	// ----------------------------------------------------------------------------------------
+
+	// TODO : remove nodes that can't reach the present / output nodes
+
+	// ----------------------------------------------------------------------------------------
+
+	std::vector<Node*> queue;
+	queue.reserve(aNodesPass.size());
+
+	if (!ApplyTopologicalOrdering(graph, queue, roots))
+	{
+		return(false);
+	}
+
+	EndCompilePhase(pDiagnostics, CompilePhase::SORT, phaseStart);
+
+	// ----------------------------------------------------------------------------------------
+
+	ScheduleCost scheduleCost;
+
+	SchedulePasses(graph, queue, roots, scheduleCost);
+
+	if (pDiagnostics != nullptr)
+	{
+		pDiagnostics->onSchedule(scheduleCost.framebufferChanges, scheduleCost.textureBinds, scheduleCost.peakBytesPerPixel);
+	}
+
+	EndCompilePhase(pDiagnostics, CompilePhase::SCHEDULE, phaseStart);
+
+	// ----------------------------------------------------------------------------------------
+
+	std::map<std::string, std::string> mapAliases;
+
+	EliminateCommonSubexpressions(graph, queue, aNodesOperator, mapAliases);
+
+	// ----------------------------------------------------------------------------------------
+
+	// Presented textures : they are the framebuffers of the application when bUseDefaultFramebuffer is true
+	std::map<const Node*, unsigned int> mapPresentedTextures; // texture -> index in aNodesPresent
+
+	for (unsigned int i = 0; i < aNodesPresent.size(); ++i)
+	{
+		std::vector<Edge*> edges;
+		graph.getEdgeTo(aNodesPresent[i], edges);
+
+		if (1 != edges.size() || edges[0]->getSource()->getType() != "texture")
+		{
+			return(false);
+		}
+
+		if (!mapPresentedTextures.insert(std::pair<const Node*, unsigned int>(edges[0]->getSource(), i)).second)
+		{
+			return(false); // two outputs presenting the same texture
+		}
+	}
+
+	std::vector<PresentLayout> & presents = program.presents;
+	presents.resize(aNodesPresent.size());
+
+	for (unsigned int i = 0; i < aNodesPresent.size(); ++i)
+	{
+		presents[i].name = aNodesPresent[i]->getId();
+		presents[i].framebuffer = ~0u; // set when the framebuffer is created
+	}
+
+	// ----------------------------------------------------------------------------------------
+
+	std::vector<RenderGraph::Value> & values = program.values;
+	values.reserve(aNodesFloat.size() + aNodesInput.size());
+
+	for (Node * node : aNodesFloat)
+	{
+		const std::string & strId = node->getId();
+
+		std::vector<unsigned int> outputs;
+
+		{
+			unsigned int index = values.size();
+			outputs.push_back(index);
+
+			RenderGraph::Value value;
+			value.asFloat = atof(node->getMetaData("value").c_str());
+			values.push_back(value);
+		}
+
+		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(strId, outputs));
+	}
+
+	// Subgraph inputs are written when the subgraph is invoked
+	for (Node * node : aNodesInput)
+	{
+		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(node->getId(), std::vector<unsigned int>(1, values.size())));
+
+		RenderGraph::Value value;
+		value.asUInt = 0;
+		values.push_back(value);
+	}
+
+	// Constants can be set from outside (Instance::setConstant) : they stay pinned to their slot, temporaries reuse slots
+	std::vector<Node*> aNodesTemporary;
+	aNodesTemporary.reserve(aNodesOperator.size() + aNodesPass.size() + aNodesSubgraph.size());
+	aNodesTemporary.insert(aNodesTemporary.end(), aNodesOperator.begin(), aNodesOperator.end());
+	aNodesTemporary.insert(aNodesTemporary.end(), aNodesPass.begin(), aNodesPass.end());
+	aNodesTemporary.insert(aNodesTemporary.end(), aNodesSubgraph.begin(), aNodesSubgraph.end());
+
+	AllocateTemporaryValues(graph, queue, aNodesTemporary, mapOutputCounts, mapAliases, values, mapValues);
+
+	if (pDiagnostics != nullptr)
+	{
+		// Slots are allocated in this order : constants, subgraph inputs (both pinned), then temporaries
+		for (const std::pair<const std::string, std::vector<unsigned int>> & entry : mapValues)
+		{
+			for (unsigned int i = 0; i < entry.second.size(); ++i)
+			{
+				unsigned int index = entry.second[i];
+				ValueKind kind = ValueKind::TEMPORARY;
+
+				if (index < aNodesFloat.size())
+				{
+					kind = ValueKind::CONSTANT;
+				}
+				else if (index < aNodesFloat.size() + aNodesInput.size())
+				{
+					kind = ValueKind::INPUT;
+				}
+
+				pDiagnostics->onValue(index, entry.first.c_str(), i, kind, values[index]);
+			}
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------
+
+	std::vector<TextureLayout> & textures = program.textures;
+	textures.reserve(aNodesTexture.size());
+
+	std::set<const Node*> setResolved; // multisample textures read after they are rendered
+	std::map<const Node*, unsigned int> mapLevels; // mip level of a texture rendered by the passes (0 if not in the map)
+
+	{
+		std::vector<Node*> aNodesAllocated; // presented textures are the framebuffers of the application when bUseDefaultFramebuffer is true
+		std::vector<Node*> aNodesMipmap; // views of a mip level of another texture (metadata "mipmap" and "level"), they share its slot
+		std::set<const Node*> setPinned; // content still needed after the last node ran
+		std::map<const Node*, TextureLayout> mapLayouts;
+
+		for (Node * node : aNodesTexture)
+		{
+			if (!bUseDefaultFramebuffer || mapPresentedTextures.find(node) == mapPresentedTextures.end())
+			{
+				if (!node->getMetaData("mipmap").empty())
+				{
+					aNodesMipmap.push_back(node);
+					continue;
+				}
+
+				TextureLayout layout;
+
+				if (!ParseTextureLayout(node, layout))
+				{
+					return(false); // invalid size
+				}
+
+				mapLayouts.insert(std::pair<const Node*, TextureLayout>(node, layout));
+				aNodesAllocated.push_back(node);
+			}
+		}
+
+		for (Node * root : roots)
+		{
+			std::vector<Edge*> edges;
+			graph.getEdgeTo(root, edges);
+
+			for (Edge * edge : edges)
+			{
+				setPinned.insert(edge->getSource());
+			}
+		}
+
+		// A mip chain is alive from the first pass rendering one of its levels to the last pass reading one : it is not aliased
+		std::map<const Node*, const Node*> mapMipmaps; // view -> texture
+
+		for (Node * node : aNodesMipmap)
+		{
+			const std::string & strTexture = node->getMetaData("mipmap");
+
+			std::vector<Node*>::const_iterator it = std::find_if(aNodesAllocated.begin(), aNodesAllocated.end(), [&strTexture](const Node * texture)
+			{
+				return(texture->getId() == strTexture);
+			});
+
+			if (it == aNodesAllocated.end())
+			{
+				return(false); // not a texture
+			}
+
+			const int level = atoi(node->getMetaData("level").c_str());
+
+			if (level < 0 || static_cast<unsigned int>(level) >= mapLayouts[*it].levels)
+			{
+				return(false); // not a level of the mip chain
+			}
+
+			mapMipmaps[node] = *it;
+			mapLevels[node] = level;
+			setPinned.insert(*it);
+		}
+
+		// Passes read a single-sample copy of a multisample texture, made once after it is rendered
+		// (part of the layout before allocation : only textures resolved alike share a slot, as in the variant and reload keys)
+		for (Node * node : aNodesAllocated)
+		{
+			std::vector<Edge*> outEdges;
+			graph.getEdgeFrom(node, outEdges);
+
+			if (mapLayouts[node].samples > 1 && (!outEdges.empty() || setPinned.find(node) != setPinned.end()))
+			{
+				setResolved.insert(node);
+				mapLayouts[node].resolve = true;
+			}
+		}
+
+		const unsigned int savedBytesPerPixel = AllocateTextures(graph, queue, aNodesAllocated, mapLayouts, setPinned, textures, mapTextures);
+
+		for (const std::pair<const Node * const, const Node*> & mipmap : mapMipmaps)
+		{
+			mapTextures.insert(std::pair<std::string, unsigned int>(mipmap.first->getId(), mapTextures[mipmap.second->getId()]));
+		}
+
+		aNodesAllocated.insert(aNodesAllocated.end(), aNodesMipmap.begin(), aNodesMipmap.end()); // for diagnostics
+
+		if (pDiagnostics != nullptr)
+		{
+			for (Node * node : aNodesAllocated)
+			{
+				const std::string & strId = node->getId();
+				unsigned int index = mapTextures[strId];
+				pDiagnostics->onTexture(index, strId.c_str(), textures[index].format);
+			}
+
+			pDiagnostics->onTextureAliasing(aNodesAllocated.size(), textures.size(), savedBytesPerPixel);
+		}
+	}
+
+	// ----------------------------------------------------------------------------------------
+
+	std::vector<OperationLayout> & operations = program.operations;
+	operations.reserve(aNodesPass.size());
+
+	std::map<std::string, unsigned int> mapOperations;
+
+	for (Node * node : aNodesPass)
+	{
+		const std::string & strId = node->getId();
+		const std::string & strSubType = node->getMetaData("subtype");
+
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		std::vector<Edge*> outEdges;
+		graph.getEdgeFrom(node, outEdges);
+
+		OperationLayout operation;
+		operation.id = strId;
+		operation.subtype = strSubType;
+		operation.inputs = inEdges.size();
+		operation.outputs = outEdges.size();
+
+		mapOperations.insert(std::pair<std::string, unsigned int>(strId, operations.size()));
+
+		operations.push_back(operation);
+	}
+
+	// ----------------------------------------------------------------------------------------
+
+	std::vector<FramebufferLayout> & framebuffers = program.framebuffers;
+	framebuffers.reserve(aNodesPass.size());
+
+	std::map<const Node*, const FramebufferLayout*> mapAttachments; // pass -> textures it renders into (in attachment order)
+
+	for (Node * node : aNodesPass)
+	{
+		const std::string & strId = node->getId();
+
+		std::vector<Edge*> outEdges;
+		graph.getEdgeFrom(node, outEdges);
+
+		std::vector<unsigned int> aPresented; // outputs rendered by this pass
+
+		for (Edge * edge : outEdges)
 		{
-			unsigned int index = it->second;
-			uint16_t addr = (index & 0xFFFF);
+			auto it = mapPresentedTextures.find(edge->getTarget());
 
-			bytecode.push_back(uint8_t(RenderGraph::OpCode::CALL));
-			bytecode.push_back(uint8_t((addr >> 8) & 0xFF));
-			bytecode.push_back(uint8_t((addr) & 0xFF));
-			printf("CALL %d\n", index);
+			if (it != mapPresentedTextures.end())
+			{
+				aPresented.push_back(it->second);
+				presents[it->second].operations.push_back(mapOperations[strId]);
+			}
+		}
+
+		if (bUseDefaultFramebuffer && !aPresented.empty())
+		{
+			assert(outEdges.size() == 1);
 		}
 		else
 		{
-			assert(false);
+			FramebufferLayout framebuffer;
+
+			for (Edge * edge : outEdges)
+			{
+				Node * target = edge->getTarget();
+
+				if (target->getType() == "texture")
+				{
+					auto it = mapTextures.find(target->getId());
+
+					if (it != mapTextures.end())
+					{
+						framebuffer.textures.push_back(it->second);
+
+						auto itLevel = mapLevels.find(target);
+						framebuffer.levels.push_back((itLevel != mapLevels.end()) ? itLevel->second : 0);
+					}
+					else
+					{
+						assert(false);
+					}
+				}
+			}
+
+			if (!framebuffer.textures.empty())
+			{
+				auto it = mapOperations.find(strId);
+
+				if (it != mapOperations.end())
+				{
+					framebuffer.operation = it->second;
+
+					for (unsigned int present : aPresented)
+					{
+						presents[present].framebuffer = framebuffers.size();
+					}
+
+					framebuffers.push_back(framebuffer);
+				}
+			}
 		}
 	}
 
-	for (int i = 0; i < outputs.size(); ++i)
+	for (const FramebufferLayout & framebuffer : framebuffers)
 	{
-		bytecode.push_back(uint8_t(RenderGraph::OpCode::POP));
-		bytecode.push_back(uint8_t((outputs[i] >> 8) & 0xFF));
-		bytecode.push_back(uint8_t((outputs[i]) & 0xFF));
-		printf("POP %d\n", outputs[i]);
+		mapAttachments[aNodesPass[framebuffer.operation]] = &framebuffer;
+
+		// The viewport of a pass is the size of its attachments
+		const TextureLayout & first = textures[framebuffer.textures[0]];
+
+		for (unsigned int i = 0; i < framebuffer.textures.size(); ++i)
+		{
+			const TextureLayout & layout = textures[framebuffer.textures[i]];
+
+			if (framebuffer.levels[i] != framebuffer.levels[0])
+			{
+				return(false); // outputs of a pass must render the same mip level
+			}
+
+			if (layout.scale != first.scale || layout.width != first.width || layout.height != first.height)
+			{
+				return(false); // outputs of a pass must have the same size
+			}
+
+			if (layout.samples != first.samples)
+			{
+				return(false); // and the same number of samples
+			}
+		}
+	}
+
+	for (const PresentLayout & present : presents)
+	{
+		if (present.operations.empty() || (!bUseDefaultFramebuffer && present.framebuffer >= framebuffers.size()))
+		{
+			return(false); // presented texture not rendered by any pass
+		}
+	}
+
+	EndCompilePhase(pDiagnostics, CompilePhase::ALLOCATE, phaseStart);
+
+	// ----------------------------------------------------------------------------------------
+
+	// Render pass scopes : consecutive passes rendering into the same attachments bind the framebuffer once
+	std::set<const Node*> setMergedWithPrevious;
+	std::set<const Node*> setMergedWithNext;
+
+	{
+		const Node * pPreviousPass = nullptr;
+
+		for (std::vector<Node*>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
+		{
+			if ((*it)->getType() == "subgraph")
+			{
+				pPreviousPass = nullptr; // the passes of the subgraph bind their own framebuffers, the next pass must bind its framebuffer again
+				continue;
+			}
+
+			if ((*it)->getType() != "pass")
+			{
+				continue; // operators only run on the VM
+			}
+
+			if (pPreviousPass != nullptr)
+			{
+				auto itPrevious = mapAttachments.find(pPreviousPass);
+				auto itCurrent = mapAttachments.find(*it);
+
+				if (itPrevious != mapAttachments.end() && itCurrent != mapAttachments.end() && itPrevious->second->textures == itCurrent->second->textures && itPrevious->second->levels == itCurrent->second->levels)
+				{
+					setMergedWithNext.insert(pPreviousPass);
+					setMergedWithPrevious.insert(*it);
+				}
+			}
+
+			pPreviousPass = *it;
+		}
+	}
+
+	std::vector<uint8_t> & bytecode = program.bytecode;
+
+	// Prologue of a subgraph : inputs were pushed in order by the invoking code
+	for (std::vector<Node*>::reverse_iterator it = aNodesInput.rbegin(); it != aNodesInput.rend(); ++it)
+	{
+		genInstructionBytecode(OpCode::POP, (0 << 15) | (mapValues[(*it)->getId()][0] & 0x7FFF), bytecode);
+	}
+
+	for (std::vector<Node*>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
+	{
+		Node * node = *it;
+
+		const std::string & strCurrentNodeId = node->getId();
+
+		if (mapAliases.find(strCurrentNodeId) != mapAliases.end())
+		{
+			continue; // already computed by the canonical node
+		}
+
+		if (node->getType() == "addition")
+		{
+			genOperatorBytecode(OpCode::ADD, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "subtraction")
+		{
+			genOperatorBytecode(OpCode::SUB, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "multiplication")
+		{
+			genOperatorBytecode(OpCode::MUL, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "division")
+		{
+			genOperatorBytecode(OpCode::DIV, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "negation")
+		{
+			genOperatorBytecode(OpCode::NEG, 1, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "absolute")
+		{
+			genOperatorBytecode(OpCode::ABS, 1, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "equal")
+		{
+			genOperatorBytecode(OpCode::EQ, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "not_equal")
+		{
+			genOperatorBytecode(OpCode::NEQ, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "greater_than")
+		{
+			genOperatorBytecode(OpCode::GT, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "greater_than_or_equal")
+		{
+			genOperatorBytecode(OpCode::GTE, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "less_than")
+		{
+			genOperatorBytecode(OpCode::LT, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "less_than_or_equal")
+		{
+			genOperatorBytecode(OpCode::LTE, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "not")
+		{
+			genOperatorBytecode(OpCode::NOT, 1, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "and")
+		{
+			genOperatorBytecode(OpCode::AND, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "or")
+		{
+			genOperatorBytecode(OpCode::OR, 2, graph, node, mapValues, bytecode);
+		}
+		else if (node->getType() == "pass")
+		{
+			const bool bMergedWithPrevious = (setMergedWithPrevious.find(node) != setMergedWithPrevious.end());
+			const bool bMergedWithNext = (setMergedWithNext.find(node) != setMergedWithNext.end());
+
+			if (!bMergedWithPrevious && !bMergedWithNext)
+			{
+				genOperationBytecode(mapOperations, mapTextures, graph, node, mapValues, bytecode, OpCode::CALL);
+			}
+			else
+			{
+				genPassScopeBytecode(bMergedWithPrevious ? OpCode::RESUME : OpCode::BEGIN, mapOperations, node, bytecode);
+
+				genOperationBytecode(mapOperations, mapTextures, graph, node, mapValues, bytecode, OpCode::DRAW);
+
+				if (!bMergedWithNext)
+				{
+					genPassScopeBytecode(OpCode::END, mapOperations, node, bytecode);
+				}
+			}
+
+			if (!bMergedWithNext)
+			{
+				genResolveBytecode(mapTextures, setResolved, graph, node, bytecode); // passes of a scope render the same textures, resolve them once
+			}
+		}
+		else if (node->getType() == "subgraph")
+		{
+			unsigned int site = mapSites[node];
+
+			if (!genInvocationBytecode(graph, node, site, *subgraphs[site].second, mapAliases, mapValues, bytecode))
+			{
+				return(false);
+			}
+		}
+	}
+
+	// Epilogue of a subgraph : outputs are pushed in order, the invoking code pops them
+	for (Node * node : aNodesOutput)
+	{
+		std::vector<Edge*> inEdges;
+		graph.getEdgeTo(node, inEdges);
+
+		std::string strId;
+		unsigned int outputParamIndex = 0;
+
+		if (inEdges.size() != 1 || !ResolveValueSource(graph, inEdges[0], mapAliases, strId, outputParamIndex))
+		{
+			return(false);
+		}
+
+		auto itValue = mapValues.find(strId);
+
+		if (itValue == mapValues.end() || outputParamIndex >= itValue->second.size())
+		{
+			return(false);
+		}
+
+		genInstructionBytecode(OpCode::PUSH, (0 << 15) | (itValue->second[outputParamIndex] & 0x7FFF), bytecode);
+	}
+
+	if (bytecode.size() == 0)
+	{
+		return(false);
+	}
+
+	bytecode.push_back(uint8_t(bSubgraph ? OpCode::RET : OpCode::HALT));
+
+	if (!LinkSubgraphs(program, subgraphs))
+	{
+		return(false);
+	}
+
+	EndCompilePhase(pDiagnostics, CompilePhase::CODEGEN, phaseStart);
+
+	if (pDiagnostics != nullptr)
+	{
+		Disassemble(bytecode, pDiagnostics);
 	}
+
+	return(true);
 }
 
-namespace RenderGraph
+/**
+ * @brief Create an instance rendering into its own final framebuffer
+ * @param program
+ * @return
+ */
+Instance * Factory::createInstanceFromProgram(const Program & program) const
 {
+	return(createInstanceFromProgram(std::make_shared<const Program>(program), false));
+}
 
 /**
- * @brief Default constructor
+ * @brief Create an instance rendering into a framebuffer provided by the application
+ * @param program
+ * @param defaultFramebuffer
+ * @return
  */
-Factory::Factory(void)
+Instance * Factory::createInstanceFromProgram(const Program & program, unsigned int /*GLuint*/ defaultFramebuffer) const
 {
-	// ...
+	return(createInstanceFromProgram(std::make_shared<const Program>(program), true, defaultFramebuffer));
 }
 
 /**
- * @brief Destructor
+ * @brief Create an instance of a shared program, rendering into its own final framebuffer
+ * @param program
+ * @return
  */
-Factory::~Factory(void)
+Instance * Factory::createInstanceFromProgram(const SharedProgram & program) const
 {
-	// ...
+	return(createInstanceFromProgram(program, false));
+}
+
+/**
+ * @brief Create an instance of a shared program, rendering into a framebuffer provided by the application
+ * @param program
+ * @param defaultFramebuffer
+ * @return
+ */
+Instance * Factory::createInstanceFromProgram(const SharedProgram & program, unsigned int /*GLuint*/ defaultFramebuffer) const
+{
+	return(createInstanceFromProgram(program, true, defaultFramebuffer));
 }
 
-/**
- * @brief Factory::createInstanceFromGraph
- * @param graph
- * @return
- */
-Instance * Factory::createInstanceFromGraph(const Graph & graph) const
-{
-	std::map<std::string, unsigned int> mapTextures;
-	std::map<std::string, std::vector<unsigned int>> mapValues;
+/**
+ * @brief Create the resources (textures, operations, framebuffers) of a compiled program
+ * @param sharedProgram
+ * @param bUseDefaultFramebuffer
+ * @param defaultFramebuffer
+ * @return
+ */
+Instance * Factory::createInstanceFromProgram(const SharedProgram & sharedProgram, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer) const
+{
+	assert(sharedProgram);
+
+	const Program & program = *sharedProgram;
+
+	if (program.useDefaultFramebuffer != bUseDefaultFramebuffer)
+	{
+		assert(false); // the program was compiled for the other mode
+		return(nullptr);
+	}
+
+	if (!CheckPresents(program))
+	{
+		assert(false);
+		return(nullptr);
+	}
+
+	Diagnostics * pDiagnostics = m_pDiagnostics;
+	InitScheduler * pInitScheduler = m_pInitScheduler;
+
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+
+	std::vector<Texture*> textures;
+	textures.reserve(program.textures.size());
+
+	for (const TextureLayout & layout : program.textures)
+	{
+		textures.push_back(new Texture(layout, m_pTexturePool));
+	}
+
+	std::vector<Operation*> operations;
+	operations.reserve(program.operations.size());
+
+	for (const OperationLayout & layout : program.operations)
+	{
+		operations.push_back(createOperation(layout, pInitScheduler));
+	}
+
+	std::vector<Framebuffer*> framebuffers;
+	framebuffers.reserve(program.framebuffers.size());
 
-	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, false);
+	for (const FramebufferLayout & layout : program.framebuffers)
+	{
+		std::vector<Texture*> fbTextures;
 
-	assert(pInstance != nullptr);
+		for (unsigned int index : layout.textures)
+		{
+			fbTextures.push_back(textures[index]);
+		}
 
-	return pInstance;
-}
+		framebuffers.push_back(new Framebuffer(fbTextures, layout.levels, static_cast<Pass*>(operations[layout.operation]), m_pFramebufferCache));
+	}
 
-/**
- * @brief Factory::createInstanceFromGraph
- * @param graph
- * @return
- */
-Instance * Factory::createInstanceFromGraph(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const
-{
-	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, false);
+	EndCompilePhase(pDiagnostics, CompilePhase::CREATE_OPERATIONS, phaseStart);
 
-	assert(pInstance != nullptr);
+	Instance * pRenderGraph = nullptr;
 
-	return pInstance;
+	if (bUseDefaultFramebuffer)
+	{
+		pRenderGraph = new InstanceWithExternalFramebuffer(sharedProgram, operations, framebuffers, textures, defaultFramebuffer);
+	}
+	else
+	{
+		pRenderGraph = new InstanceWithInternalFramebuffer(sharedProgram, operations, framebuffers, textures);
+	}
+
+	assert(pRenderGraph != nullptr);
+
+	return(pRenderGraph);
 }
 
 /**
- * @brief Factory::createInstanceFromGraph
- * @param graph
- * @param defaultFramebuffer
+ * @brief Create an instance able to switch between several programs (quality tiers), each rendering into its own final framebuffer
+ * @param programs variants, the first one is active
  * @return
  */
-Instance * Factory::createInstanceFromGraph(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer) const
+Instance * Factory::createInstanceFromPrograms(const std::vector<Program> & programs) const
 {
-	std::map<std::string, unsigned int> mapTextures;
-	std::map<std::string, std::vector<unsigned int>> mapValues;
-
-	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, true, defaultFramebuffer);
+	std::vector<SharedProgram> sharedPrograms;
 
-	assert(pInstance != nullptr);
+	for (const Program & program : programs)
+	{
+		sharedPrograms.push_back(std::make_shared<const Program>(program));
+	}
 
-	return pInstance;
+	return(createInstanceFromPrograms(sharedPrograms, false));
 }
 
 /**
- * @brief Factory::createInstanceFromGraph
- * @param graph
+ * @brief Create an instance able to switch between several programs (quality tiers), rendering into a framebuffer provided by the application
+ * @param programs variants, the first one is active
  * @param defaultFramebuffer
  * @return
  */
-Instance * Factory::createInstanceFromGraph(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const
+Instance * Factory::createInstanceFromPrograms(const std::vector<Program> & programs, unsigned int /*GLuint*/ defaultFramebuffer) const
 {
-	Instance * pInstance = createInstanceFromGraph(graph, mapTextures, mapValues, true, defaultFramebuffer);
+	std::vector<SharedProgram> sharedPrograms;
 
-	assert(pInstance != nullptr);
+	for (const Program & program : programs)
+	{
+		sharedPrograms.push_back(std::make_shared<const Program>(program));
+	}
 
-	return pInstance;
+	return(createInstanceFromPrograms(sharedPrograms, true, defaultFramebuffer));
 }
 
 /**
- * @brief Factory::createInstanceFromGraph
- * @param graph
+ * @brief Create the resources of several programs, the nodes they have in common share their resources
+ *
+ * A texture is shared when it has the same node id and format, an operation when it has the same node id, subtype,
+ * signature and attachments (so a shared pass always renders into the same framebuffer).
+ *
+ * @param programs
+ * @param bUseDefaultFramebuffer
+ * @param defaultFramebuffer
  * @return
  */
-Instance * Factory::createInstanceFromGraph(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer) const
+Instance * Factory::createInstanceFromPrograms(const std::vector<SharedProgram> & programs, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer) const
 {
-	mapTextures.clear();
-	mapValues.clear();
-
-	Node * pNodePresent = nullptr;
-	std::vector<Node*> aNodesTexture;
-	std::vector<Node*> aNodesFloat;
-	std::vector<Node*> aNodesPass;
-	std::vector<Node*> aNodesOperator;
+	if (programs.empty())
+	{
+		assert(false);
+		return(nullptr);
+	}
 
-	for (Node * node : graph.getNodes())
+	for (const SharedProgram & program : programs)
 	{
-		if (node->getType() == "present")
-		{
-			assert(nullptr == pNodePresent);
-			pNodePresent = node;
-		}
-		else if (node->getType() == "texture")
-		{
-			aNodesTexture.push_back(node);
-		}
-		else if (node->getType() == "pass")
-		{
-			aNodesPass.push_back(node);
-		}
-		else if (node->getType() == "float")
-		{
-			aNodesFloat.push_back(node);
-		}
-		else if (node->getType() == "addition")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "subtraction")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "multiplication")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "division")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "negation")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "absolute")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "equal_to")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "not_equal_to")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "greater_than")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "greater_than_or_equal_to")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "less_than")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "less_than_or_equal_to")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "not")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "and")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else if (node->getType() == "or")
-		{
-			aNodesOperator.push_back(node);
-		}
-		else
+		if (program->useDefaultFramebuffer != bUseDefaultFramebuffer || !CheckPresents(*program))
 		{
 			assert(false);
+			return(nullptr);
 		}
 	}
 
-	if (nullptr == pNodePresent)
+	Instance * pInstance = createInstanceFromProgram(programs[0], bUseDefaultFramebuffer, defaultFramebuffer);
+
+	if (nullptr == pInstance || programs.size() == 1)
 	{
-		assert(false);
-		return nullptr;
+		return(pInstance);
 	}
 
-	// ----------------------------------------------------------------------------------------
+	InitScheduler * pInitScheduler = m_pInitScheduler;
 
-	// TODO : remove nodes that can't reach pNodePresent
+	std::map<std::string, Texture*> sharedTextures; // id + format -> texture
+	std::map<std::string, Operation*> sharedOperations; // GetOperationKey -> operation
+	std::vector<Framebuffer*> sharedFramebuffers;
 
-	// ----------------------------------------------------------------------------------------
+	{
+		const std::vector<std::string> textureIds = GetTextureIds(*programs[0]);
 
-	std::vector<Node*> queue;
-	queue.reserve(aNodesPass.size());
+		for (unsigned int i = 0; i < pInstance->m_aTextures.size(); ++i)
+		{
+			sharedTextures[textureIds[i] + '\x1F' + GetTextureKey(programs[0]->textures[i])] = pInstance->m_aTextures[i];
+		}
 
-	if (!ApplyTopologicalOrdering(graph, queue, pNodePresent))
-	{
-		return(nullptr);
+		const std::vector<std::string> keys = GetOperationKeys(*programs[0], textureIds);
+
+		for (unsigned int i = 0; i < keys.size(); ++i)
+		{
+			sharedOperations[keys[i]] = pInstance->m_aOperations[i];
+		}
 	}
 
-	// ----------------------------------------------------------------------------------------
+	sharedFramebuffers = pInstance->m_aFramebuffers;
 
-	std::vector<Edge*> edges;
-	graph.getEdgeTo(pNodePresent, edges);
+	pInstance->m_aVariants.resize(programs.size()); // the first variant is active, it stays in the instance
 
-	if (1 != edges.size())
+	for (unsigned int v = 1; v < programs.size(); ++v)
 	{
-		return(nullptr);
-	}
+		const Program & program = *programs[v];
 
-	Node * pDefaultFramebufferNode = edges[0]->getSource();
+		Instance::Variant & variant = pInstance->m_aVariants[v];
 
-	std::string strFinalTextureId = pDefaultFramebufferNode->getId();
+		const std::vector<std::string> textureIds = GetTextureIds(program);
 
-	// ----------------------------------------------------------------------------------------
+		for (unsigned int i = 0; i < program.textures.size(); ++i)
+		{
+			Texture *& texture = sharedTextures[textureIds[i] + '\x1F' + GetTextureKey(program.textures[i])];
 
-	std::vector<RenderGraph::Value> values;
-	values.reserve(aNodesFloat.size());
+			if (nullptr == texture)
+			{
+				texture = new Texture(program.textures[i], m_pTexturePool);
+			}
 
-	for (Node * node : aNodesFloat)
-	{
-		const std::string & strId = node->getId();
+			variant.textures.push_back(texture);
+		}
 
-		std::vector<unsigned int> outputs;
+		const std::vector<std::string> keys = GetOperationKeys(program, textureIds);
 
+		for (unsigned int i = 0; i < program.operations.size(); ++i)
 		{
-			unsigned int index = values.size();
-			outputs.push_back(index);
+			Operation *& operation = sharedOperations[keys[i]];
 
-			RenderGraph::Value value;
-			value.asFloat = atof(node->getMetaData("value").c_str());
-			values.push_back(value);
+			if (nullptr == operation)
+			{
+				operation = createOperation(program.operations[i], pInitScheduler);
+			}
 
-			printf("MEM[%d] (const float) = %f\n", index, value.asFloat);
+			variant.operations.push_back(operation);
 		}
 
-		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(strId, outputs));
+		for (const FramebufferLayout & layout : program.framebuffers)
+		{
+			std::vector<Texture*> fbTextures;
+
+			for (unsigned int index : layout.textures)
+			{
+				fbTextures.push_back(variant.textures[index]);
+			}
+
+			Pass * pass = static_cast<Pass*>(variant.operations[layout.operation]);
+
+			Framebuffer * framebuffer = nullptr;
+
+			for (Framebuffer * shared : sharedFramebuffers)
+			{
+				if (shared->getPass() == pass && shared->getTextures() == fbTextures && shared->getLevels() == layout.levels)
+				{
+					framebuffer = shared;
+					break;
+				}
+			}
+
+			if (nullptr == framebuffer)
+			{
+				framebuffer = new Framebuffer(fbTextures, layout.levels, pass, m_pFramebufferCache);
+				sharedFramebuffers.push_back(framebuffer);
+			}
+
+			variant.framebuffers.push_back(framebuffer);
+		}
+
+		variant.values = program.values;
+		variant.program = programs[v];
 	}
 
-	for (Node * node : aNodesOperator)
+	return(pInstance);
+}
+
+/**
+ * @brief Destroy an instance and its resources (texture storage goes back to the TexturePool), must run on the thread owning the context
+ * Operations not initialized yet (queued in the InitScheduler, or initializing) are destroyed when their initialization finished (see updateInstance)
+ * @param queue
+ */
+void Factory::destroyInstance(Instance * queue) const
+{
+	if (nullptr == queue)
 	{
-		const std::string & strId = node->getId();
+		return;
+	}
 
-		std::vector<unsigned int> outputs;
+	std::shared_ptr<ReloadTask> task;
 
-		{
-			unsigned int index = values.size();
-			outputs.push_back(index);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 
-			RenderGraph::Value value;
-			value.asUInt = 0;
-			values.push_back(value);
+		std::map<const Instance*, std::shared_ptr<ReloadTask>>::iterator it = m_reloads.find(queue);
 
-			printf("MEM[%d] (operator output) = 0\n", index);
+		if (it != m_reloads.end())
+		{
+			task = it->second;
+			m_reloads.erase(it);
 		}
+	}
 
-		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(strId, outputs));
+	if (task)
+	{
+		task->thread.join(); // the result is discarded
 	}
 
-	for (Node * node : aNodesPass)
+	// Variants share resources : each one is destroyed once, framebuffers before the textures they are attached to
+	std::set<Texture*> textures(queue->m_aTextures.begin(), queue->m_aTextures.end());
+	std::set<Framebuffer*> framebuffers(queue->m_aFramebuffers.begin(), queue->m_aFramebuffers.end());
+	std::set<Operation*> operations(queue->m_aOperations.begin(), queue->m_aOperations.end());
+
+	for (const Instance::Variant & variant : queue->m_aVariants)
 	{
-		const std::string & strId = node->getId();
+		textures.insert(variant.textures.begin(), variant.textures.end());
+		framebuffers.insert(variant.framebuffers.begin(), variant.framebuffers.end());
+		operations.insert(variant.operations.begin(), variant.operations.end());
+	}
 
-		std::vector<unsigned int> outputs;
+	for (Framebuffer * framebuffer : framebuffers)
+	{
+		delete framebuffer;
+	}
 
-		std::vector<Edge*> outEdges;
-		graph.getEdgeFrom(node, outEdges);
+	for (Texture * texture : textures)
+	{
+		delete texture;
+	}
 
-		unsigned int i = 0;
-		for (Edge * edge : outEdges)
+	// Operations queued or initializing are still used by the InitScheduler : only READY / FAILED ones are destroyed now
+	for (Operation * operation : operations)
+	{
+		if (nullptr != operation)
 		{
-			unsigned int index = values.size();
-			outputs.push_back(index);
+			m_aRetiredOperations.push_back(operation);
+		}
+	}
+
+	m_aRetiredOperations.insert(m_aRetiredOperations.end(), queue->m_aRetiredOperations.begin(), queue->m_aRetiredOperations.end());
+	queue->m_aRetiredOperations.clear();
+
+	destroyRetiredOperations(m_aRetiredOperations);
+
+	delete queue;
+}
+
+/**
+ * @brief Start recompiling the graph of an instance in the background
+ * @param pInstance instance to reload, it can still be executed while the graph compiles
+ * @param path graph file
+ * @return false if a reload of this instance is already in progress (or if the instance has several variants)
+ */
+bool Factory::reloadInstance(Instance * pInstance, const char * path) const
+{
+	assert(nullptr != pInstance);
+	assert(nullptr != path);
+
+	if (pInstance->getVariantCount() > 1)
+	{
+		return(false); // resources are shared between variants, replacing them would break the other variants
+	}
+
+	std::string strPath(path);
+	bool bUseDefaultFramebuffer = pInstance->isUsingDefaultFramebuffer();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
 
-			RenderGraph::Value value;
-			value.asUInt = 0;
-			values.push_back(value);
+	std::map<const Instance*, std::shared_ptr<ReloadTask>>::iterator it = m_reloads.find(pInstance);
 
-			printf("MEM[%d] (operation output %d) = 0\n", index, i++);
+	if (it != m_reloads.end())
+	{
+		if (!it->second->done)
+		{
+			return(false);
 		}
 
-		mapValues.insert(std::pair<std::string, std::vector<unsigned int>>(strId, outputs));
+		it->second->thread.join(); // finished but never applied, replaced by this reload
+		m_reloads.erase(it);
 	}
 
-	// ----------------------------------------------------------------------------------------
-
-	std::vector<Texture*> textures;
-	textures.reserve(aNodesTexture.size());
+	std::shared_ptr<ReloadTask> task = std::make_shared<ReloadTask>();
 
-	for (Node * node : aNodesTexture)
+	// started under the lock so that updateInstance never sees a task without its thread
+	task->thread = std::thread([this, task, strPath, bUseDefaultFramebuffer]
 	{
-		if (!bUseDefaultFramebuffer || node != pDefaultFramebufferNode)
-		{
-			const std::string & strId = node->getId();
-			const std::string & strFormat = node->getMetaData("format");
+		Graph graph;
+		task->success = graph.loadFromFile(strPath.c_str()) && compileGraph(graph, task->program, bUseDefaultFramebuffer);
+		task->done = true;
+	});
 
-			unsigned int index = textures.size();
+	m_reloads[pInstance] = task;
 
-			TextureFormat format = strToFormat(strFormat.c_str());
+	return(true);
+}
 
-			Texture * texture = new Texture(format);
+/**
+ * @brief Swap in the result of reloadInstance, must be called between two frames on the thread owning the context
+ * @param pInstance
+ * @return true if the instance was updated, false if nothing changed (no reload finished, or the new graph failed to compile)
+ */
+bool Factory::updateInstance(Instance * pInstance) const
+{
+	assert(nullptr != pInstance);
 
-			mapTextures.insert(std::pair<std::string, unsigned int>(strId, index));
+	destroyRetiredOperations(pInstance->m_aRetiredOperations);
+	destroyRetiredOperations(m_aRetiredOperations);
 
-			textures.push_back(texture);
+	std::shared_ptr<ReloadTask> task;
 
-			printf("TEXTURE[%d] = %" PRIXPTR "\n", index, (uintptr_t)texture);
-		}
-	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 
-	// ----------------------------------------------------------------------------------------
+		std::map<const Instance*, std::shared_ptr<ReloadTask>>::iterator it = m_reloads.find(pInstance);
 
-	std::vector<Operation*> operations;
-	operations.reserve(aNodesPass.size());
+		if (it == m_reloads.end() || !it->second->done)
+		{
+			return(false);
+		}
 
-	std::map<std::string, unsigned int> mapOperations;
+		task = it->second;
+		m_reloads.erase(it);
+	}
 
-	for (Node * node : aNodesPass)
+	task->thread.join();
+
+	if (!task->success)
 	{
-		const std::string & strId = node->getId();
-		const std::string & strSubType = node->getMetaData("subtype");
+		return(false);
+	}
+
+	return(swapProgram(pInstance, std::make_shared<const Program>(std::move(task->program))));
+}
 
-		Operation * operation = createOperation(strSubType.c_str());
+/**
+ * @brief Replace the program of an instance, reusing the GPU resources of the nodes that did not change
+ * @param pInstance
+ * @param sharedProgram
+ * @return
+ */
+bool Factory::swapProgram(Instance * pInstance, const SharedProgram & sharedProgram) const
+{
+	const Program & program = *sharedProgram;
 
-		mapOperations.insert(std::pair<std::string, unsigned int>(strId, operations.size()));
+	if (program.useDefaultFramebuffer != pInstance->isUsingDefaultFramebuffer())
+	{
+		assert(false);
+		return(false);
+	}
 
-		operations.push_back(operation);
+	if (!CheckPresents(program))
+	{
+		assert(false);
+		return(false);
 	}
 
-	// ----------------------------------------------------------------------------------------
+	InitScheduler * pInitScheduler = m_pInitScheduler;
 
-	Framebuffer * pDefaultFramebuffer = nullptr;
+	const unsigned int width = pInstance->m_iWidth;
+	const unsigned int height = pInstance->m_iHeight;
 
-	std::vector<Framebuffer*> framebuffers;
-	framebuffers.reserve(aNodesPass.size());
+	//
+	// Textures : same node id, same format and same size
+	std::map<std::string, Texture*> oldTextures;
 
-	for (Node * node : aNodesPass)
+	const std::vector<std::string> oldTextureIds = GetTextureIds(*pInstance->m_pProgram);
+
+	for (unsigned int i = 0; i < pInstance->m_aTextures.size(); ++i)
 	{
-		const std::string & strId = node->getId();
-		const std::string & strSubType = node->getMetaData("subtype");
+		oldTextures[oldTextureIds[i]] = pInstance->m_aTextures[i];
+	}
 
-		std::vector<Edge*> outEdges;
-		graph.getEdgeFrom(node, outEdges);
+	std::vector<std::string> textureIds = GetTextureIds(program);
+
+	std::vector<Texture*> textures;
+	textures.reserve(program.textures.size());
+
+	for (unsigned int i = 0; i < program.textures.size(); ++i)
+	{
+		std::map<std::string, Texture*>::iterator it = oldTextures.find(textureIds[i]);
 
-		if (bUseDefaultFramebuffer && graph.hasEdge(node, pDefaultFramebufferNode))
+		if (it != oldTextures.end() && GetTextureKey(it->second->getLayout()) == GetTextureKey(program.textures[i]))
 		{
-			assert(outEdges.size() == 1);
+			textures.push_back(it->second);
+			oldTextures.erase(it);
 		}
 		else
 		{
-			std::vector<Texture*> fbTextures;
+			Texture * texture = new Texture(program.textures[i], m_pTexturePool);
 
-			for (Edge * edge : outEdges)
+			if (width > 0 && height > 0)
 			{
-				Node * target = edge->getTarget();
-				if (target->getType() == "texture")
-				{
-					const std::string & strId = target->getId();
-
-					auto it = mapTextures.find(strId);
-
-					if (it != mapTextures.end())
-					{
-						fbTextures.push_back(textures[it->second]);
-					}
-					else
-					{
-						assert(false);
-						fbTextures.push_back(nullptr);
-					}
-				}
+				texture->resize(width, height);
 			}
 
-			if (!fbTextures.empty())
-			{
-				auto it = mapOperations.find(strId);
-
-				if (it != mapOperations.end())
-				{
-					Framebuffer * framebuffer = new Framebuffer(fbTextures, static_cast<Pass*>(operations[it->second]));
-
-					if (graph.hasEdge(node, pDefaultFramebufferNode))
-					{
-						pDefaultFramebuffer = framebuffer;
-					}
-
-					framebuffers.push_back(framebuffer);
-				}
-			}
+			textures.push_back(texture);
 		}
 	}
 
-	// ----------------------------------------------------------------------------------------
-
-	std::vector<uint8_t> bytecode;
+	//
+	// Operations : same node id and same subtype
+	std::map<std::string, std::pair<Operation*, std::string>> oldOperations;
 
-	for (std::vector<Node*>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it)
+	for (unsigned int i = 0; i < pInstance->m_aOperations.size(); ++i)
 	{
-		Node * node = *it;
+		const OperationLayout & layout = pInstance->m_pProgram->operations[i];
+		oldOperations[layout.id] = std::make_pair(pInstance->m_aOperations[i], layout.subtype);
+	}
 
-		const std::string & strCurrentNodeId = node->getId();
+	std::vector<Operation*> operations;
+	operations.reserve(program.operations.size());
 
-		if (node->getType() == "addition")
-		{
-			genOperatorBytecode(OpCode::ADD, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "subtraction")
-		{
-			genOperatorBytecode(OpCode::SUB, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "multiplication")
-		{
-			genOperatorBytecode(OpCode::MUL, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "division")
-		{
-			genOperatorBytecode(OpCode::DIV, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "negation")
-		{
-			genOperatorBytecode(OpCode::NEG, 1, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "absolute")
-		{
-			genOperatorBytecode(OpCode::ABS, 1, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "equal")
-		{
-			genOperatorBytecode(OpCode::EQ, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "not_equal")
-		{
-			genOperatorBytecode(OpCode::NEQ, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "greater_than")
-		{
-			genOperatorBytecode(OpCode::GT, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "greater_than_or_equal")
-		{
-			genOperatorBytecode(OpCode::GTE, 2, graph, node, mapValues, bytecode);
-		}
-		else if (node->getType() == "less_than")
+	for (const OperationLayout & layout : program.operations)
+	{
+		std::map<std::string, std::pair<Operation*, std::string>>::iterator it = oldOperations.find(layout.id);
+
+		if (it != oldOperations.end() && it->second.first != nullptr && it->second.second == layout.subtype)
 		{
-			genOperatorBytecode(OpCode::LT, 2, graph, node, mapValues, bytecode);
+			Operation * operation = it->second.first;
+			operation->setSignature(layout.inputs, layout.outputs);
+			operations.push_back(operation);
+			oldOperations.erase(it);
 		}
-		else if (node->getType() == "less_than_or_equal")
+		else
 		{
-			genOperatorBytecode(OpCode::LTE, 2, graph, node, mapValues, bytecode);
+			operations.push_back(createOperation(layout, pInitScheduler));
 		}
-		else if (node->getType() == "not")
+	}
+
+	//
+	// Framebuffers : same attachments and same pass
+	std::vector<Framebuffer*> oldFramebuffers = pInstance->m_aFramebuffers;
+
+	std::vector<Framebuffer*> framebuffers;
+	framebuffers.reserve(program.framebuffers.size());
+
+	std::set<Pass*> rendering;
+
+	for (const FramebufferLayout & layout : program.framebuffers)
+	{
+		std::vector<Texture*> fbTextures;
+
+		for (unsigned int index : layout.textures)
 		{
-			genOperatorBytecode(OpCode::NOT, 1, graph, node, mapValues, bytecode);
+			fbTextures.push_back(textures[index]);
 		}
-		else if (node->getType() == "and")
+
+		Pass * pass = static_cast<Pass*>(operations[layout.operation]);
+		rendering.insert(pass);
+
+		Framebuffer * framebuffer = nullptr;
+
+		for (std::vector<Framebuffer*>::iterator it = oldFramebuffers.begin(); it != oldFramebuffers.end(); ++it)
 		{
-			genOperatorBytecode(OpCode::AND, 2, graph, node, mapValues, bytecode);
+			if ((*it)->getPass() == pass && (*it)->getTextures() == fbTextures && (*it)->getLevels() == layout.levels)
+			{
+				framebuffer = *it;
+				oldFramebuffers.erase(it);
+				break;
+			}
 		}
-		else if (node->getType() == "or")
+
+		if (framebuffer == nullptr)
 		{
-			genOperatorBytecode(OpCode::OR, 2, graph, node, mapValues, bytecode);
+			framebuffer = new Framebuffer(fbTextures, layout.levels, pass, m_pFramebufferCache);
+
+			if (width > 0 && height > 0)
+			{
+				framebuffer->resize();
+			}
 		}
-		else if (node->getType() == "pass")
+
+		framebuffers.push_back(framebuffer);
+	}
+
+	//
+	// Release what the new program does not use anymore
+	for (Framebuffer * framebuffer : oldFramebuffers)
+	{
+		delete framebuffer;
+	}
+
+	for (std::pair<const std::string, Texture*> & texture : oldTextures)
+	{
+		delete texture.second;
+	}
+
+	for (std::pair<const std::string, std::pair<Operation*, std::string>> & operation : oldOperations)
+	{
+		Operation * op = operation.second.first;
+
+		if (op != nullptr)
 		{
-			genOperationBytecode(mapOperations, mapTextures, graph, node, mapValues, bytecode);
+			pInstance->m_aRetiredOperations.push_back(op); // destroyed now if READY / FAILED, else still used by the InitScheduler (queued or initializing)
 		}
 	}
 
-	if (bytecode.size() == 0)
+	destroyRetiredOperations(pInstance->m_aRetiredOperations);
+
+	//
+	// Reused passes that lost their framebuffer render to the default one
+	for (Operation * operation : operations)
 	{
-		return nullptr;
+		if (operation != nullptr && rendering.find(static_cast<Pass*>(operation)) == rendering.end())
+		{
+			static_cast<Pass*>(operation)->setFramebuffer(0, 0, 0);
+		}
 	}
 
-	bytecode.push_back(uint8_t(OpCode::HALT));
-	printf("HALT\n");
+	pInstance->m_aTextures = textures;
+	pInstance->m_aOperations = operations;
+	pInstance->m_aFramebuffers = framebuffers;
+	pInstance->m_aValues = program.values;
+	pInstance->m_pProgram = sharedProgram;
 
-	fflush(stdout);
+	pInstance->bindOutputs();
+	pInstance->bindRenderScale();
 
-	Instance * pRenderGraph = nullptr;
+	return(true);
+}
 
-	if (bUseDefaultFramebuffer)
+/**
+ * @brief Attach a diagnostics sink (nullptr to disable, which is the default)
+ * @param pDiagnostics
+ */
+void Factory::setDiagnostics(Diagnostics * pDiagnostics)
+{
+	m_pDiagnostics = pDiagnostics;
+}
+
+/**
+ * @brief Initialize operations asynchronously (nullptr to initialize them in createInstanceFromProgram, which is the default)
+ * @param pScheduler
+ */
+void Factory::setInitScheduler(InitScheduler * pScheduler)
+{
+	m_pInitScheduler = pScheduler;
+}
+
+/**
+ * @brief Enable the on-disk cache of compiled programs (nullptr to disable, which is the default)
+ * @param directory existing directory where compiled programs are stored
+ * @param maxSize maximum total size of the cache (in bytes), least recently used programs are evicted first
+ */
+void Factory::setCacheDirectory(const char * directory, size_t maxSize)
+{
+	std::shared_ptr<ProgramCache> cache;
+
+	if (directory != nullptr)
 	{
-		pRenderGraph = new InstanceWithExternalFramebuffer(bytecode, operations, framebuffers, textures, values, defaultFramebuffer);
+		cache = std::make_shared<ProgramCache>(directory, maxSize);
 	}
-	else
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cache = cache; // compilations in progress keep the previous cache alive
+}
+
+/**
+ * @brief Factory::getCacheStatistics
+ * @return hits / misses / evictions since the cache was enabled
+ */
+CacheStatistics Factory::getCacheStatistics(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_cache)
 	{
-		pRenderGraph = new InstanceWithInternalFramebuffer(bytecode, operations, framebuffers, textures, values, pDefaultFramebuffer);
+		CacheStatistics statistics;
+		statistics.hits = 0;
+		statistics.misses = 0;
+		statistics.evictions = 0;
+		return(statistics);
 	}
 
-	assert(pRenderGraph != nullptr);
+	return(m_cache->getStatistics());
+}
 
-	return(pRenderGraph);
+/**
+ * @brief Set the maximum size of the render target memory shared by the instances of this factory (0, the default, keeps no idle texture)
+ * Textures released by a resize or by destroyInstance stay idle for reuse until the pool exceeds this size
+ * @param maxSize in bytes
+ */
+void Factory::setTextureBudget(size_t maxSize)
+{
+	m_pTexturePool->setBudget(maxSize);
 }
 
 /**
- * @brief Factory::destroyQueue
- * @param queue
+ * @brief Factory::getTexturePoolStatistics (on the thread owning the GL context)
+ * @return allocations / reuses / evictions, and the memory allocated for render targets
  */
-void Factory::destroyInstance(Instance * queue) const
+TexturePoolStatistics Factory::getTexturePoolStatistics(void) const
 {
-	delete queue;
+	return(m_pTexturePool->getStatistics());
 }
 
 /**
@@ -896,6 +3694,8 @@ void Factory::destroyInstance(Instance * queue) const
  */
 bool Factory::registerOperation(const char * identifier, OperationFactory factory)
 {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
 	m_factories.insert(std::pair<std::string, OperationFactory>(identifier, factory));
 
 	return(true);
@@ -908,20 +3708,56 @@ bool Factory::registerOperation(const char * identifier, OperationFactory factor
  */
 Operation * Factory::createOperation(const char * identifier) const
 {
-	auto it = m_factories.find(identifier);
+	OperationFactory factory = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_factories.find(identifier);
 
-	if (it != m_factories.end())
+		if (it != m_factories.end())
+		{
+			factory = it->second;
+		}
+	}
+
+	if (factory != nullptr)
 	{
-		OperationFactory factory = it->second;
 		Operation * operation = factory();
 		assert(operation != nullptr);
-		operation->init();
 		return operation;
 	}
 
 	return(nullptr);
 }
 
+/**
+ * @brief Create an operation of a program, and initialize it (or schedule its initialization)
+ * @param layout
+ * @param pInitScheduler
+ * @return
+ */
+Operation * Factory::createOperation(const OperationLayout & layout, InitScheduler * pInitScheduler) const
+{
+	Operation * operation = createOperation(layout.subtype.c_str());
+
+	if (operation != nullptr)
+	{
+		operation->setSignature(layout.inputs, layout.outputs);
+
+		if (pInitScheduler != nullptr)
+		{
+			pInitScheduler->schedule(operation); // Instance::execute uses Operation::fallback until it is ready
+		}
+		else
+		{
+			operation->initialize();
+		}
+	}
+
+	return(operation);
+}
+
 /**
  * @brief Factory::destroyOperation
  * @param operation
@@ -932,4 +3768,24 @@ void Factory::destroyOperation(Operation * operation) const
 	delete operation;
 }
 
+/**
+ * @brief Destroy the retired operations whose initialization finished
+ * @param retired (in/out) operations still queued or initializing are kept
+ */
+void Factory::destroyRetiredOperations(std::vector<Operation*> & retired) const
+{
+	for (std::vector<Operation*>::iterator it = retired.begin(); it != retired.end();)
+	{
+		if ((*it)->getState() == Operation::STATE_READY || (*it)->getState() == Operation::STATE_FAILED)
+		{
+			destroyOperation(*it);
+			it = retired.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
 }
@@ -4,6 +4,14 @@
 #include <map>
 #include <string>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "Cache.h"
+#include "TexturePool.h"
+#include "Program.h"
+
 class Graph;
 
 namespace RenderGraph
@@ -11,9 +19,48 @@ namespace RenderGraph
 
 class Operation;
 class Instance;
+class Diagnostics;
+class FramebufferCache;
+class InitScheduler;
+struct ReloadTask;
+struct SubgraphContext;
 
 typedef Operation* (*OperationFactory)(void);
 
+/**
+ * @brief Compiles graphs into programs, and creates instances of programs
+ *
+ * Instances need an OpenGL 4.3 context : render targets use immutable storage (glTexStorage2D, GL 4.2)
+ * and multisample targets glTexStorage2DMultisample (GL 4.3).
+ *
+ * A Factory can be used from several threads at the same time :
+ * - compileGraph / compileGraphs only read the graph and never touch the GL context, they can run on any thread
+ *   (the graph must not be modified during compilation, and an attached Diagnostics sink must be thread-safe)
+ * - createInstanceFromProgram creates the GL resources and initializes the operations, it must run on the thread owning the context
+ *   (operations are initialized by the InitScheduler instead, when one is attached)
+ * - registerOperation / setDiagnostics / setCacheDirectory can be called while other threads compile
+ * - reloadInstance compiles on its own thread, updateInstance applies the result and must run on the thread owning the context
+ *
+ * A "texture" node is the size of the instance, scaled by its metadata "scale" (e.g. 0.5 for half resolution), or has a fixed size
+ * (metadata "width" and "height"). A pass renders at the size of its outputs, which must all have the same size.
+ * Metadata "samples" makes a multisample texture : the passes reading it get a single-sample copy, resolved once after it is rendered.
+ * Metadata "levels" makes a mip chain : a "texture" node with metadata "mipmap" (id of the chain) and "level" is a view of one level,
+ * the passes rendering it get a framebuffer and a viewport for that level, the passes reading it get the whole chain.
+ *
+ * Textures of the same format and size that are never alive at the same time in a frame share one GL texture :
+ * only presented textures (and the outputs of a subgraph) keep their content after the last pass ran.
+ *
+ * Render targets of all the instances come from one TexturePool, bounded by setTextureBudget.
+ *
+ * A program can be shared by any number of instances (compileGraph into a SharedProgram, or Instance::getProgram) :
+ * each instance only owns its value memory and resources, the bytecode and layouts are never copied.
+ *
+ * Quality tiers : compile the variants of a graph (compileGraphs) and create one instance from all of them (createInstanceFromPrograms).
+ * Variants share the textures and operations of the nodes they have in common, Instance::setVariant switches between them.
+ *
+ * A "subgraph" node references another graph file (metadata "graph") whose "input" / "output" nodes (metadata "index") are its parameters.
+ * Each referenced file is compiled once per compilation into a block of code, invoked at every use site with its own resources.
+ */
 class Factory
 {
 public:
@@ -23,22 +70,74 @@ public:
 
 	bool			registerOperation			(const char * identifier, OperationFactory factory);
 
+	void			setDiagnostics				(Diagnostics * pDiagnostics);
+
+	void			setInitScheduler			(InitScheduler * pScheduler);
+
+	void			setCacheDirectory			(const char * directory, size_t maxSize);
+	CacheStatistics	getCacheStatistics			(void) const;
+
+	void			setTextureBudget			(size_t maxSize);
+	TexturePoolStatistics	getTexturePoolStatistics	(void) const;
+
 	Instance *		createInstanceFromGraph		(const Graph & graph) const;
 	Instance *		createInstanceFromGraph		(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const;
 	Instance *		createInstanceFromGraph		(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer) const;
 	Instance *		createInstanceFromGraph		(const Graph & graph, unsigned int /*GLuint*/ defaultFramebuffer, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues) const;
 	void			destroyInstance				(Instance * queue) const;
 
+	bool			compileGraph				(const Graph & graph, Program & program, bool bUseDefaultFramebuffer = false) const;
+	bool			compileGraph				(const Graph & graph, SharedProgram & program, bool bUseDefaultFramebuffer = false) const;
+	bool			compileGraphs				(const std::vector<const Graph*> & graphs, std::vector<Program> & programs, unsigned int threadCount = 0, bool bUseDefaultFramebuffer = false) const;
+
+	Instance *		createInstanceFromProgram	(const Program & program) const;
+	Instance *		createInstanceFromProgram	(const Program & program, unsigned int /*GLuint*/ defaultFramebuffer) const;
+	Instance *		createInstanceFromProgram	(const SharedProgram & program) const;
+	Instance *		createInstanceFromProgram	(const SharedProgram & program, unsigned int /*GLuint*/ defaultFramebuffer) const;
+
+	Instance *		createInstanceFromPrograms	(const std::vector<Program> & programs) const;
+	Instance *		createInstanceFromPrograms	(const std::vector<Program> & programs, unsigned int /*GLuint*/ defaultFramebuffer) const;
+
+	bool			reloadInstance				(Instance * pInstance, const char * path) const;
+	bool			updateInstance				(Instance * pInstance) const;
+
 protected:
 
 	Instance *		createInstanceFromGraph		(const Graph & graph, std::map<std::string, unsigned int> & mapTextures, std::map<std::string, std::vector<unsigned int>> & mapValues, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer = 0) const;
+	Instance *		createInstanceFromProgram	(const SharedProgram & program, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer = 0) const;
+	Instance *		createInstanceFromPrograms	(const std::vector<SharedProgram> & programs, bool bUseDefaultFramebuffer, unsigned int /*GLuint*/ defaultFramebuffer = 0) const;
+
+	bool			generateProgram				(const Graph & graph, Program & program, bool bUseDefaultFramebuffer) const;
+	bool			generateProgram				(const Graph & graph, Program & program, bool bUseDefaultFramebuffer, SubgraphContext & context) const;
+	const Program *	generateSubgraph			(const std::string & path, SubgraphContext & context) const;
+	uint64_t		computeCacheKey				(const Graph & graph, bool bUseDefaultFramebuffer) const;
+
+	bool			swapProgram					(Instance * pInstance, const SharedProgram & program) const;
 
 	Operation *		createOperation				(const char * identifier) const;
+	Operation *		createOperation				(const OperationLayout & layout, InitScheduler * pInitScheduler) const;
 	void			destroyOperation			(Operation * operation) const;
+	void			destroyRetiredOperations	(std::vector<Operation*> & retired) const;
 
 private:
 
+	mutable std::mutex m_mutex; // protects m_factories, m_cache and m_reloads
+
 	std::map<std::string, OperationFactory> m_factories;
+
+	std::atomic<Diagnostics*> m_pDiagnostics;
+
+	std::atomic<InitScheduler*> m_pInitScheduler;
+
+	std::shared_ptr<ProgramCache> m_cache;
+
+	std::shared_ptr<TexturePool> m_pTexturePool; // render targets of all instances, kept alive by their textures
+
+	std::shared_ptr<FramebufferCache> m_pFramebufferCache; // framebuffer objects of all instances, kept alive by their framebuffers
+
+	mutable std::map<const Instance*, std::shared_ptr<ReloadTask>> m_reloads;
+
+	mutable std::vector<Operation*> m_aRetiredOperations; // of destroyed instances, still queued or initializing (only used on the thread owning the context)
 };
 
 }
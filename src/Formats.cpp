@@ -86,4 +86,75 @@ TextureFormat strToFormat(const char * str)
 	return(UNKNOWN);
 }
 
+/**
+ * @brief Size of a texel (used to estimate the memory of render targets)
+ * @param format
+ * @return
+ */
+unsigned int getBytesPerPixel(TextureFormat format)
+{
+	switch (format)
+	{
+		case R8:
+		case R8I:
+		case R8UI:
+		case STENCIL_INDEX8:
+			return(1);
+
+		case RG8:
+		case R16:
+		case R16F:
+		case RG8I:
+		case R16I:
+		case RG8UI:
+		case R16UI:
+		case DEPTH_COMPONENT16:
+			return(2);
+
+		case DEPTH_COMPONENT24:
+			return(3);
+
+		case RGBA8:
+		case RG16:
+		case RG16F:
+		case R32F:
+		case RGBA8I:
+		case RG16I:
+		case R32I:
+		case RGBA8UI:
+		case RG16UI:
+		case R32UI:
+		case RGB10_A2:
+		case RGB10_A2UI:
+		case R11F_G11F_B10F:
+		case SRGB8_ALPHA8:
+		case DEPTH_COMPONENT32F:
+		case DEPTH24_STENCIL8:
+			return(4);
+
+		case DEPTH32F_STENCIL8:
+			return(5);
+
+		case RGBA16:
+		case RGBA16F:
+		case RG32F:
+		case RGBA16I:
+		case RG32I:
+		case RGBA16UI:
+		case RG32UI:
+			return(8);
+
+		case RGBA32F:
+		case RGBA32I:
+		case RGBA32UI:
+			return(16);
+
+		case UNKNOWN:
+			break;
+	}
+
+	assert(false);
+	return(0);
+}
+
 }
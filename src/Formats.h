@@ -51,4 +51,6 @@ enum TextureFormat
 
 TextureFormat strToFormat(const char * str);
 
+unsigned int getBytesPerPixel(TextureFormat format);
+
 }
@@ -8,86 +8,246 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 namespace RenderGraph
 {
 
 /**
  * @brief Constructor
- * @param textures
  */
-Framebuffer::Framebuffer(const std::vector<Texture*> & textures_, Pass * pass_) : textures(textures_), pass(pass_), currentWidth(0), currentHeight(0)
+FramebufferCache::FramebufferCache(void)
 {
-	framebufferId = 0;
+	// ...
 }
 
 /**
  * @brief Destructor
  */
-Framebuffer::~Framebuffer(void)
+FramebufferCache::~FramebufferCache(void)
 {
-	if (framebufferId != 0)
-	{
-		glDeleteFramebuffers(1, &framebufferId);
-		framebufferId = 0;
-	}
+	assert(entries.empty()); // all framebuffers must be destroyed first
 }
 
 /**
- * @brief Resize framebuffer
- * @param width
- * @param height
- * @return
+ * @brief Get the framebuffer object rendering into these textures, and attach their current storage
+ * @param attachments textures (color attachments are numbered in this order) and the mip level rendered in each one
+ * @return 0 if the attachments are not supported
  */
-bool Framebuffer::resize(unsigned int width, unsigned int height)
+unsigned int /*GLuint*/ FramebufferCache::acquire(const Attachments & attachments)
 {
-	if (framebufferId != 0)
+	const std::vector<Texture*> & textures = attachments.first;
+	const std::vector<unsigned int> & levels = attachments.second;
+
+	assert(textures.size() == levels.size());
+
+	std::map<Attachments, Entry>::iterator it = entries.find(attachments);
+
+	if (it == entries.end())
 	{
-		glDeleteFramebuffers(1, &framebufferId);
-		framebufferId = 0;
-	}
+		GLint maxDrawBuffers = 0;
+		glGetIntegerv(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers);
+
+		GLint maxColorAttachments = 0;
+		glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxColorAttachments);
+
+		std::vector<GLenum> drawBuffers;
+
+		for (Texture * texture : textures)
+		{
+			if (texture->isColorTexture())
+			{
+				drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + drawBuffers.size());
+			}
+		}
+
+		if (drawBuffers.size() > static_cast<unsigned int>(std::min(maxDrawBuffers, maxColorAttachments)))
+		{
+			assert(false); // too many render targets for this GPU
+			return(0);
+		}
 
-	glGenFramebuffers(1, &framebufferId);
+		if (drawBuffers.empty())
+		{
+			drawBuffers.push_back(GL_NONE); // depth only
+		}
 
-	assert(framebufferId != 0);
+		Entry entry;
+		entry.framebuffer = 0;
+		entry.attachments.resize(textures.size(), 0);
+		entry.references = 0;
 
-	glBindFramebuffer(GL_FRAMEBUFFER, framebufferId);
+		glGenFramebuffers(1, &entry.framebuffer);
+
+		assert(entry.framebuffer != 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+		glDrawBuffers(drawBuffers.size(), drawBuffers.data()); // part of the framebuffer state, passes don't set it
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		it = entries.insert(std::pair<Attachments, Entry>(attachments, entry)).first;
+	}
+
+	Entry & entry = it->second;
+
+	bool bAttached = false;
 
 	unsigned int colorAttachmentIndex = 0;
 
-	for (Texture * texture : textures)
+	for (unsigned int i = 0; i < textures.size(); ++i)
 	{
-		assert(texture->getWidth() == width);
-		assert(texture->getHeight() == height);
+		Texture * texture = textures[i];
+
+		GLenum attachment = GL_COLOR_ATTACHMENT0 + colorAttachmentIndex;
 
 		if (texture->isDepthTexture())
 		{
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture->getNativeHandle(), 0);
+			attachment = GL_DEPTH_ATTACHMENT;
 		}
 		else if (texture->isStencilTexture())
 		{
-			assert(false); // TODO
+			attachment = GL_STENCIL_ATTACHMENT;
 		}
 		else if (texture->isDepthStencilTexture())
 		{
-			assert(false); // TODO
+			attachment = GL_DEPTH_STENCIL_ATTACHMENT; // one packed texture for depth and stencil
 		}
 		else
 		{
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + colorAttachmentIndex, GL_TEXTURE_2D, texture->getNativeHandle(), 0);
 			++colorAttachmentIndex;
 		}
+
+		if (entry.attachments[i] == texture->getStorage())
+		{
+			continue; // same storage (not the GL name : a deleted texture and the one replacing it can have the same name)
+		}
+
+		if (!bAttached)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+			bAttached = true;
+		}
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, (texture->getSamples() > 1) ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D, texture->getRenderHandle(), levels[i]);
+
+		entry.attachments[i] = texture->getStorage();
+	}
+
+	if (bAttached)
+	{
+		assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	++entry.references;
+
+	return(entry.framebuffer);
+}
+
+/**
+ * @brief Release a framebuffer object, it is deleted when no framebuffer uses it anymore
+ * @param attachments
+ */
+void FramebufferCache::release(const Attachments & attachments)
+{
+	std::map<Attachments, Entry>::iterator it = entries.find(attachments);
+
+	assert(it != entries.end());
+
+	if (--it->second.references == 0)
+	{
+		glDeleteFramebuffers(1, &it->second.framebuffer);
+		entries.erase(it);
+	}
+}
+
+/**
+ * @brief Constructor
+ * @param textures
+ * @param levels mip level rendered in each texture
+ * @param pass rendering into the framebuffer (nullptr if its operation type is not registered)
+ * @param cache framebuffer objects
+ */
+Framebuffer::Framebuffer(const std::vector<Texture*> & textures, const std::vector<unsigned int> & levels, Pass * pass_, const std::shared_ptr<FramebufferCache> & cache_) : attachments(textures, levels), pass(pass_), cache(cache_), currentWidth(0), currentHeight(0)
+{
+	assert(cache);
+	assert(textures.size() == levels.size());
+	framebufferId = 0;
+}
+
+/**
+ * @brief Destructor
+ */
+Framebuffer::~Framebuffer(void)
+{
+	if (framebufferId != 0)
+	{
+		cache->release(attachments);
+		framebufferId = 0;
+	}
+}
+
+/**
+ * @brief Attach the storage of the textures after they were resized, the pass renders at the size of the mip level it renders
+ * @return false if a texture is too small to have this mip level
+ */
+bool Framebuffer::resize(void)
+{
+	const std::vector<Texture*> & textures = attachments.first;
+	const std::vector<unsigned int> & levels = attachments.second;
+
+	assert(!textures.empty());
+
+	for (unsigned int i = 0; i < textures.size(); ++i)
+	{
+		if (levels[i] >= textures[i]->getLevels())
+		{
+			if (framebufferId != 0)
+			{
+				cache->release(attachments);
+				framebufferId = 0;
+			}
+
+			currentWidth = 0;
+			currentHeight = 0;
+
+			if (pass != nullptr)
+			{
+				pass->setFramebuffer(0, 0, 0); // empty viewport, the pass draws nothing
+			}
+
+			return false;
+		}
+	}
+
+	const unsigned int width = std::max(1u, textures[0]->getWidth() >> levels[0]);
+	const unsigned int height = std::max(1u, textures[0]->getHeight() >> levels[0]);
+
+	for (unsigned int i = 0; i < textures.size(); ++i)
+	{
+		assert(std::max(1u, textures[i]->getWidth() >> levels[i]) == width); // attachments of a pass have the same size policy
+		assert(std::max(1u, textures[i]->getHeight() >> levels[i]) == height);
 	}
 
-	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	const unsigned int /*GLuint*/ framebuffer = cache->acquire(attachments); // before releasing the previous one, so it is not deleted
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (framebufferId != 0)
+	{
+		cache->release(attachments);
+	}
+
+	framebufferId = framebuffer;
 
 	currentWidth = width;
 	currentHeight = height;
 
-	pass->setFramebuffer(framebufferId, width, height);
+	if (pass != nullptr) // operation type not registered
+	{
+		pass->setFramebuffer(framebufferId, width, height);
+	}
 
-	return true;
+	return framebufferId != 0;
 }
 
 /**
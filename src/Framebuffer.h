@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vector>
+#include <map>
+#include <memory>
 
 namespace RenderGraph
 {
@@ -8,18 +10,63 @@ namespace RenderGraph
 class Texture;
 class Pass;
 
+/**
+ * @brief Framebuffer objects shared by the framebuffers with the same attachments (in the same order, same mip levels)
+ *
+ * Resizing only re-attaches the textures whose storage changed, the draw buffers (one per color attachment, up to GL_MAX_DRAW_BUFFERS)
+ * are set once when the framebuffer object is created. Must be used on the thread owning the GL context.
+ */
+class FramebufferCache
+{
+public:
+
+	FramebufferCache(void);
+	~FramebufferCache(void);
+
+	typedef std::pair<std::vector<Texture*>, std::vector<unsigned int>> Attachments; // textures, mip level of each texture
+
+	unsigned int /*GLuint*/ acquire(const Attachments & attachments);
+	void release(const Attachments & attachments);
+
+private:
+
+	struct Entry
+	{
+		unsigned int /*GLuint*/ framebuffer;
+		std::vector<unsigned int> attachments; // storage attached to each attachment point (Texture::getStorage, 0 : none)
+		unsigned int references;
+	};
+
+	std::map<Attachments, Entry> entries;
+};
+
 class Framebuffer
 {
 public:
 
-	Framebuffer(const std::vector<Texture*> & textures, Pass * pass);
+	Framebuffer(const std::vector<Texture*> & textures, const std::vector<unsigned int> & levels, Pass * pass, const std::shared_ptr<FramebufferCache> & cache);
 	~Framebuffer(void);
 
-	bool resize(unsigned int width, unsigned int height);
+	bool resize(void);
 
 	unsigned int getWidth(void) const;
 	unsigned int getHeight(void) const;
 
+	const std::vector<Texture*> & getTextures(void) const
+	{
+		return(attachments.first);
+	}
+
+	const std::vector<unsigned int> & getLevels(void) const
+	{
+		return(attachments.second);
+	}
+
+	Pass * getPass(void) const
+	{
+		return(pass);
+	}
+
 	unsigned int /*GLuint*/ getNativeHandle(void) const
 	{
 		return(framebufferId);
@@ -27,9 +74,11 @@ public:
 
 private:
 
-	const std::vector<Texture*> textures;
+	const FramebufferCache::Attachments attachments;
 	Pass * pass;
 
+	std::shared_ptr<FramebufferCache> cache;
+
 	unsigned int currentWidth;
 	unsigned int currentHeight;
 
@@ -3,6 +3,7 @@
 #include "Texture.h"
 #include "Framebuffer.h"
 #include "Pass.h"
+#include "ResolutionGovernor.h"
 
 #include "Graph.h"
 
@@ -12,7 +13,9 @@
 
 #include <assert.h>
 
+#include <set>
 #include <stack>
+#include <algorithm>
 
 #if defined(__GNUC__) || defined(__clang__)
 #	define LIKELY(condition) __builtin_expect(!!(condition), 1)
@@ -27,18 +30,22 @@ namespace RenderGraph
 
 /**
  * @brief Constructor
- * @param bytecode
+ * @param program
  * @param operations
  * @param framebuffers
  * @param textures
- * @param values
  */
-Instance::Instance(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values)
-	: m_aValues(values),
+Instance::Instance(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures)
+	: m_aValues(program->values),
 	  m_aTextures(textures),
 	  m_aFramebuffers(framebuffers),
 	  m_aOperations(operations),
-	  m_bytecode(bytecode)
+	  m_pProgram(program),
+	  m_iVariant(0),
+	  m_iWidth(0),
+	  m_iHeight(0),
+	  m_fRenderScale(1.0f),
+	  m_pGovernor(nullptr)
 {
 	// ...
 }
@@ -48,34 +55,108 @@ Instance::Instance(const std::vector<uint8_t> & bytecode, const std::vector<Oper
  */
 Instance::~Instance(void)
 {
-	// ...
+	delete m_pGovernor;
 }
 
 /**
- * @brief Resize textures / framebuffers
+ * @brief Resize textures / framebuffers (textures with a relative size are scaled, fixed-size textures are not)
  * @param width
  * @param height
  * @return
  */
 bool Instance::resize(unsigned int width, unsigned int height)
 {
+	// Variants share resources : each one is resized once, textures before the framebuffers they are attached to
+	std::set<Texture*> textures(m_aTextures.begin(), m_aTextures.end());
+	std::set<Framebuffer*> framebuffers(m_aFramebuffers.begin(), m_aFramebuffers.end());
+
+	for (const Variant & variant : m_aVariants)
+	{
+		textures.insert(variant.textures.begin(), variant.textures.end());
+		framebuffers.insert(variant.framebuffers.begin(), variant.framebuffers.end());
+	}
+
 	//
 	// Resize textures
-	for (Texture * texture : m_aTextures)
+	for (Texture * texture : textures)
 	{
 		texture->resize(width, height);
 	}
 
 	//
 	// Resize framebuffers
-	for (Framebuffer * framebuffer : m_aFramebuffers)
+	for (Framebuffer * framebuffer : framebuffers)
 	{
-		framebuffer->resize(width, height);
+		framebuffer->resize();
 	}
 
+	m_iWidth = width;
+	m_iHeight = height;
+
+	bindOutputs();
+
+	return true;
+}
+
+/**
+ * @brief Dynamic resolution : render the targets with a relative size into a part of their storage, nothing is reallocated
+ * Passes sample these targets with a UV scale (Pass::getRenderScale), the passes rendering the outputs upscale them
+ * @param scale in ]0, 1] (of the size set by resize)
+ * @return false if the scale is out of range
+ */
+bool Instance::setRenderScale(float scale)
+{
+	if (!(scale > 0.0f && scale <= 1.0f))
+	{
+		return false;
+	}
+
+	m_fRenderScale = scale;
+
+	bindRenderScale();
+
 	return true;
 }
 
+/**
+ * @brief Instance::getRenderScale
+ * @return
+ */
+float Instance::getRenderScale(void) const
+{
+	return m_fRenderScale;
+}
+
+/**
+ * @brief Let execute adjust the render scale to keep the GPU time of a frame in a budget (measured with timer queries)
+ * Must be called on the thread owning the GL context
+ * @param milliseconds GPU time budget of a frame (0 disables the governor, the render scale is left as it is)
+ * @param minScale
+ * @param maxScale
+ * @param hysteresis fraction of the budget under which the scale goes up
+ */
+void Instance::setFrameBudget(float milliseconds, float minScale, float maxScale, float hysteresis)
+{
+	delete m_pGovernor;
+	m_pGovernor = nullptr;
+
+	if (milliseconds > 0.0f)
+	{
+		m_pGovernor = new ResolutionGovernor(milliseconds, minScale, maxScale, hysteresis);
+
+		setRenderScale(std::max(minScale, std::min(maxScale, m_fRenderScale)));
+	}
+}
+
+/**
+ * @brief Smoothed GPU time of a frame measured by the governor, in milliseconds (0 when disabled or not measured yet)
+ * @return
+ */
+float Instance::getGpuTime(void) const
+{
+	return (m_pGovernor != nullptr) ? m_pGovernor->getGpuTime() : 0.0f;
+}
+
 /**
  * @brief Render Frame
  * @return
@@ -84,14 +165,30 @@ bool Instance::execute(void)
 {
 	std::stack<Value> stack;
 
-	uint8_t * current = m_bytecode.data();
+	const std::vector<uint8_t> & bytecode = m_pProgram->bytecode;
 
-	bool bRunning = m_bytecode.size() > 0;
+	const uint8_t * current = bytecode.data();
+
+	// Resources of the running subgraph start at these bases (0 in the graph itself)
+	InvocationLayout frame;
+	frame.entry = 0;
+	frame.values = 0;
+	frame.textures = 0;
+	frame.operations = 0;
+
+	std::vector<std::pair<const uint8_t*, InvocationLayout>> frames; // return address, bases of the invoking code
+
+	bool bRunning = bytecode.size() > 0;
+
+	if (m_pGovernor != nullptr)
+	{
+		m_pGovernor->begin();
+	}
 
 	while (bRunning)
 	{
 		// fetch next instruction
-		assert(current < m_bytecode.data() + m_bytecode.size());
+		assert(current < bytecode.data() + bytecode.size());
 		uint8_t instruction = READ_BYTE();
 
 		// decode instruction
@@ -114,12 +211,12 @@ bool Instance::execute(void)
 				if (bIsTexture)
 				{
 					Value v;
-					v.asUInt = m_aTextures[addr]->getNativeHandle();
+					v.asUInt = m_aTextures[frame.textures + addr]->getNativeHandle();
 					stack.push(v);
 				}
 				else
 				{
-					stack.push(m_aValues[addr]);
+					stack.push(m_aValues[frame.values + addr]);
 				}
 			}
 			break;
@@ -134,7 +231,7 @@ bool Instance::execute(void)
 
 				assert(!bIsTexture); // can't pop in texture
 
-				m_aValues[addr] = stack.top();
+				m_aValues[frame.values + addr] = stack.top();
 				stack.pop();
 			}
 			break;
@@ -615,7 +712,7 @@ bool Instance::execute(void)
 				uint8_t addrlo = READ_BYTE();
 				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
 
-				current = m_bytecode.data() + addr;
+				current = bytecode.data() + addr;
 			}
 			break;
 
@@ -630,7 +727,7 @@ bool Instance::execute(void)
 
 				if (v.asBool == true)
 				{
-					current = m_bytecode.data() + addr;
+					current = bytecode.data() + addr;
 				}
 			}
 			break;
@@ -646,7 +743,7 @@ bool Instance::execute(void)
 
 				if (v.asBool == false)
 				{
-					current = m_bytecode.data() + addr;
+					current = bytecode.data() + addr;
 				}
 			}
 			break;
@@ -657,12 +754,128 @@ bool Instance::execute(void)
 				uint8_t addrlo = READ_BYTE();
 				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
 
-				Operation * op = m_aOperations[addr];
+				Operation * op = m_aOperations[frame.operations + addr];
 
 				if (LIKELY(op))
 				{
 					Parameters params(stack);
-					bRunning = op->execute(params);
+
+					if (LIKELY(op->isReady()))
+					{
+						bRunning = op->execute(params);
+					}
+					else
+					{
+						bRunning = op->fallback(params); // still initializing
+					}
+				}
+				else
+				{
+					bRunning = false; // exit
+				}
+			}
+			break;
+
+			case OpCode::INVOKE:
+			{
+				uint8_t addrhi = READ_BYTE();
+				uint8_t addrlo = READ_BYTE();
+				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
+
+				const InvocationLayout & invocation = m_pProgram->invocations[addr];
+
+				frames.push_back(std::pair<const uint8_t*, InvocationLayout>(current, frame));
+
+				// bases are relative to the invoking code (the same subgraph code runs for every use site)
+				frame.values += invocation.values;
+				frame.textures += invocation.textures;
+				frame.operations += invocation.operations;
+
+				current = bytecode.data() + invocation.entry;
+			}
+			break;
+
+			case OpCode::RET:
+			{
+				assert(!frames.empty());
+
+				current = frames.back().first;
+				frame = frames.back().second;
+				frames.pop_back();
+			}
+			break;
+
+			case OpCode::BEGIN:
+			case OpCode::RESUME:
+			case OpCode::END:
+			{
+				uint8_t addrhi = READ_BYTE();
+				uint8_t addrlo = READ_BYTE();
+				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
+
+				Pass * pass = static_cast<Pass*>(m_aOperations[frame.operations + addr]);
+
+				if (LIKELY(pass))
+				{
+					if (OpCode(instruction) == OpCode::BEGIN)
+					{
+						bRunning = pass->begin(); // bind the framebuffer once for the whole scope
+					}
+					else if (OpCode(instruction) == OpCode::RESUME)
+					{
+						bRunning = pass->resume();
+					}
+					else
+					{
+						bRunning = pass->end();
+					}
+				}
+				else
+				{
+					bRunning = false; // exit
+				}
+			}
+			break;
+
+			case OpCode::RESOLVE:
+			{
+				uint8_t addrhi = READ_BYTE();
+				uint8_t addrlo = READ_BYTE();
+				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
+
+				Texture * texture = m_aTextures[frame.textures + addr];
+
+				if (LIKELY(texture))
+				{
+					bRunning = texture->resolve(); // multisample texture -> texture read by the next passes
+				}
+				else
+				{
+					bRunning = false; // exit
+				}
+			}
+			break;
+
+			case OpCode::DRAW:
+			{
+				uint8_t addrhi = READ_BYTE();
+				uint8_t addrlo = READ_BYTE();
+				uint16_t addr = ((addrhi << 8) | addrlo) & 0xFFFF;
+
+				Pass * pass = static_cast<Pass*>(m_aOperations[frame.operations + addr]);
+
+				if (LIKELY(pass))
+				{
+					Parameters params(stack);
+
+					if (LIKELY(pass->isReady()))
+					{
+						bRunning = pass->render(params);
+					}
+					else
+					{
+						bRunning = pass->fallback(params); // still initializing
+					}
 				}
 				else
 				{
@@ -684,9 +897,210 @@ bool Instance::execute(void)
 		}
 	}
 
+	if (m_pGovernor != nullptr)
+	{
+		float scale = m_fRenderScale;
+
+		if (m_pGovernor->end(scale))
+		{
+			setRenderScale(scale); // from the next frame
+		}
+	}
+
 	return true;
 }
 
+/**
+ * @brief Check if all operations finished their initialization
+ * @return
+ */
+bool Instance::isReady(void) const
+{
+	for (Operation * operation : m_aOperations)
+	{
+		if (operation != nullptr && !operation->isReady())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Compiled program of the active variant, to create more instances of the same graph (Factory::createInstanceFromProgram)
+ * @return
+ */
+const SharedProgram & Instance::getProgram(void) const
+{
+	return m_pProgram;
+}
+
+/**
+ * @brief Number of outputs (present nodes of the graph)
+ * @return
+ */
+unsigned int Instance::getOutputCount(void) const
+{
+	return m_pProgram->presents.size();
+}
+
+/**
+ * @brief Name of an output (id of its present node), outputs are sorted by name
+ * @param index
+ * @return
+ */
+const char * Instance::getOutputName(unsigned int index) const
+{
+	assert(index < m_pProgram->presents.size());
+	return m_pProgram->presents[index].name.c_str();
+}
+
+/**
+ * @brief Find an output by name
+ * @param name
+ * @param index (output)
+ * @return false if the graph has no output with this name
+ */
+bool Instance::findOutput(const char * name, unsigned int & index) const
+{
+	for (unsigned int i = 0; i < m_pProgram->presents.size(); ++i)
+	{
+		if (m_pProgram->presents[i].name == name)
+		{
+			index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Number of variants (programs the instance can switch between, see Factory::createInstanceFromPrograms)
+ * @return
+ */
+unsigned int Instance::getVariantCount(void) const
+{
+	return m_aVariants.empty() ? 1 : m_aVariants.size();
+}
+
+/**
+ * @brief Index of the active variant
+ * @return
+ */
+unsigned int Instance::getVariant(void) const
+{
+	return m_iVariant;
+}
+
+/**
+ * @brief Switch to another variant (between two frames), no resource is created or destroyed
+ * Each variant has its own value memory : setConstant only changes the active variant
+ * @param index
+ * @return
+ */
+bool Instance::setVariant(unsigned int index)
+{
+	if (index >= getVariantCount())
+	{
+		return false;
+	}
+
+	if (index != m_iVariant)
+	{
+		swapVariant(m_aVariants[m_iVariant]); // store the active variant
+		swapVariant(m_aVariants[index]); // load the new one
+
+		m_iVariant = index;
+
+		bindOutputs();
+		bindRenderScale();
+	}
+
+	return true;
+}
+
+/**
+ * @brief Exchange the active program and resources with a variant
+ * @param variant
+ */
+void Instance::swapVariant(Variant & variant)
+{
+	m_aValues.swap(variant.values);
+	m_aTextures.swap(variant.textures);
+	m_aFramebuffers.swap(variant.framebuffers);
+	m_aOperations.swap(variant.operations);
+
+	m_pProgram.swap(variant.program);
+}
+
+/**
+ * @brief Framebuffer created for an output (when the instance does not use the framebuffers of the application)
+ * @param index
+ * @return
+ */
+Framebuffer * Instance::getPresentFramebuffer(unsigned int index) const
+{
+	assert(index < m_pProgram->presents.size());
+	return m_aFramebuffers[m_pProgram->presents[index].framebuffer];
+}
+
+/**
+ * @brief Make the passes rendering the outputs render into the framebuffers of the application
+ */
+void Instance::bindOutputs(void)
+{
+	if (!isUsingDefaultFramebuffer())
+	{
+		return; // outputs have their own framebuffers, see Framebuffer::resize
+	}
+
+	for (unsigned int i = 0; i < m_pProgram->presents.size(); ++i)
+	{
+		for (unsigned int index : m_pProgram->presents[i].operations)
+		{
+			Pass * pass = static_cast<Pass*>(m_aOperations[index]);
+
+			if (pass != nullptr) // operation type not registered, execute exits before it
+			{
+				pass->setFramebuffer(getOutputFramebuffer(i), m_iWidth, m_iHeight);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Set the render scale of the passes : all of them sample with it, the viewport is scaled unless the pass renders an output or a fixed-size target
+ */
+void Instance::bindRenderScale(void)
+{
+	for (Operation * operation : m_aOperations)
+	{
+		if (operation != nullptr)
+		{
+			static_cast<Pass*>(operation)->setRenderScale(m_fRenderScale, false);
+		}
+	}
+
+	std::set<unsigned int> presented;
+
+	for (const PresentLayout & present : m_pProgram->presents)
+	{
+		presented.insert(present.framebuffer);
+	}
+
+	for (unsigned int i = 0; i < m_aFramebuffers.size(); ++i)
+	{
+		Framebuffer * framebuffer = m_aFramebuffers[i];
+
+		if (framebuffer != nullptr && framebuffer->getPass() != nullptr && presented.find(i) == presented.end() && framebuffer->getTextures()[0]->hasRelativeSize())
+		{
+			framebuffer->getPass()->setRenderScale(m_fRenderScale, true);
+		}
+	}
+}
+
 /**
  * @brief Instance::getRenderTexture
  * @param index
@@ -739,16 +1153,15 @@ void Instance::setConstant(unsigned int index, bool value)
 
 /**
  * @brief Constructor
- * @param bytecode
+ * @param program
  * @param operations
  * @param framebuffers
  * @param textures
- * @param values
  * @param defaultFramebuffer
  */
-InstanceWithExternalFramebuffer::InstanceWithExternalFramebuffer(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values, unsigned int /*GLuint*/ defaultFramebuffer)
-	: Instance (bytecode, operations, framebuffers, textures, values),
-	  m_iDefaultFramebuffer(defaultFramebuffer)
+InstanceWithExternalFramebuffer::InstanceWithExternalFramebuffer(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, unsigned int /*GLuint*/ defaultFramebuffer)
+	: Instance (program, operations, framebuffers, textures),
+	  m_aOutputFramebuffers(1, defaultFramebuffer)
 {
 	// ...
 }
@@ -767,23 +1180,56 @@ InstanceWithExternalFramebuffer::~InstanceWithExternalFramebuffer()
  */
 unsigned int InstanceWithExternalFramebuffer::getDefaultFramebuffer(void) const
 {
-	return m_iDefaultFramebuffer;
+	return m_aOutputFramebuffers[0];
+}
+
+/**
+ * @brief InstanceWithExternalFramebuffer::isUsingDefaultFramebuffer
+ * @return
+ */
+bool InstanceWithExternalFramebuffer::isUsingDefaultFramebuffer(void) const
+{
+	return true;
+}
+
+/**
+ * @brief InstanceWithExternalFramebuffer::getOutputFramebuffer
+ * @param index
+ * @return
+ */
+unsigned int InstanceWithExternalFramebuffer::getOutputFramebuffer(unsigned int index) const
+{
+	return (index < m_aOutputFramebuffers.size()) ? m_aOutputFramebuffers[index] : 0;
+}
+
+/**
+ * @brief Set the framebuffer of the application an output renders into (the default framebuffer is output 0)
+ * @param index
+ * @param framebuffer
+ */
+void InstanceWithExternalFramebuffer::setOutputFramebuffer(unsigned int index, unsigned int /*GLuint*/ framebuffer)
+{
+	if (index >= m_aOutputFramebuffers.size())
+	{
+		m_aOutputFramebuffers.resize(index + 1, 0);
+	}
+
+	m_aOutputFramebuffers[index] = framebuffer;
+
+	bindOutputs();
 }
 
 /**
  * @brief Constructor
- * @param bytecode
+ * @param program
  * @param operations
  * @param framebuffers
  * @param textures
- * @param values
- * @param pDefaultFramebuffer
  */
-InstanceWithInternalFramebuffer::InstanceWithInternalFramebuffer(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values, Framebuffer * pDefaultFramebuffer)
-	: Instance (bytecode, operations, framebuffers, textures, values),
-	  m_pDefaultFramebuffer(pDefaultFramebuffer)
+InstanceWithInternalFramebuffer::InstanceWithInternalFramebuffer(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures)
+	: Instance (program, operations, framebuffers, textures)
 {
-	assert(nullptr != pDefaultFramebuffer);
+	// ...
 }
 
 /**
@@ -800,7 +1246,26 @@ InstanceWithInternalFramebuffer::~InstanceWithInternalFramebuffer()
  */
 unsigned int InstanceWithInternalFramebuffer::getDefaultFramebuffer(void) const
 {
-	return m_pDefaultFramebuffer->getNativeHandle();
+	return getOutputFramebuffer(0);
+}
+
+/**
+ * @brief InstanceWithInternalFramebuffer::isUsingDefaultFramebuffer
+ * @return
+ */
+bool InstanceWithInternalFramebuffer::isUsingDefaultFramebuffer(void) const
+{
+	return false;
+}
+
+/**
+ * @brief InstanceWithInternalFramebuffer::getOutputFramebuffer
+ * @param index
+ * @return
+ */
+unsigned int InstanceWithInternalFramebuffer::getOutputFramebuffer(unsigned int index) const
+{
+	return getPresentFramebuffer(index)->getNativeHandle();
 }
 
 }
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <vector>
+#include <string>
 
 #include "VM.h"
+#include "Program.h"
 
 namespace RenderGraph
 {
@@ -12,17 +14,33 @@ class Texture;
 
 class Operation;
 
+class Factory;
+
+class ResolutionGovernor;
+
 class Instance
 {
+	friend class Factory; // creates the resources, and replaces them on reload
+
 public:
 
-	Instance(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values);
+	Instance(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures);
 	virtual ~Instance(void);
 
 	bool resize(unsigned int width, unsigned int height);
 
+	bool setRenderScale(float scale);
+	float getRenderScale(void) const;
+
+	void setFrameBudget(float milliseconds, float minScale = 0.5f, float maxScale = 1.0f, float hysteresis = 0.1f);
+	float getGpuTime(void) const;
+
 	bool execute(void);
 
+	bool isReady(void) const;
+
+	const SharedProgram & getProgram(void) const;
+
 	unsigned int getRenderTexture(unsigned int index) const;
 
 	void setConstant(unsigned int index, unsigned int value);
@@ -32,6 +50,26 @@ public:
 
 	virtual unsigned int getDefaultFramebuffer(void) const = 0;
 
+	virtual bool isUsingDefaultFramebuffer(void) const = 0;
+
+	unsigned int getOutputCount(void) const;
+	const char * getOutputName(unsigned int index) const;
+	bool findOutput(const char * name, unsigned int & index) const;
+
+	virtual unsigned int getOutputFramebuffer(unsigned int index) const = 0;
+
+	unsigned int getVariantCount(void) const;
+	unsigned int getVariant(void) const;
+	bool setVariant(unsigned int index);
+
+protected:
+
+	Framebuffer * getPresentFramebuffer(unsigned int index) const;
+
+	void bindOutputs(void);
+
+	void bindRenderScale(void);
+
 private:
 
 	std::vector<Value> m_aValues;
@@ -39,35 +77,68 @@ private:
 	std::vector<Framebuffer*> m_aFramebuffers;
 	std::vector<Operation*> m_aOperations;
 
-	std::vector<uint8_t> m_bytecode;
+	SharedProgram m_pProgram; // bytecode and layouts (shared with the other instances of the program)
+
+	/**
+	 * @brief Program of a variant, and its resources (shared with the other variants when they have the same node)
+	 */
+	struct Variant
+	{
+		std::vector<Value> values;
+		std::vector<Texture*> textures;
+		std::vector<Framebuffer*> framebuffers;
+		std::vector<Operation*> operations;
+
+		SharedProgram program;
+	};
+
+	void swapVariant(Variant & variant);
+
+	std::vector<Variant> m_aVariants; // empty unless created from several programs, the active variant is stored in the members above
+	unsigned int m_iVariant;
+
+	std::vector<Operation*> m_aRetiredOperations; // replaced by a reload while still queued or initializing
+
+	unsigned int m_iWidth;
+	unsigned int m_iHeight;
+
+	float m_fRenderScale; // dynamic resolution, textures stay allocated at the size of the instance
+
+	ResolutionGovernor * m_pGovernor; // adjusts m_fRenderScale to the frame budget (nullptr when disabled)
 };
 
 class InstanceWithExternalFramebuffer : public Instance
 {
 public:
 
-	InstanceWithExternalFramebuffer(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values, unsigned int defaultFramebuffer);
+	InstanceWithExternalFramebuffer(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, unsigned int defaultFramebuffer);
 	virtual ~InstanceWithExternalFramebuffer(void) override;
 
 	virtual unsigned int getDefaultFramebuffer(void) const override;
 
+	virtual bool isUsingDefaultFramebuffer(void) const override;
+
+	virtual unsigned int getOutputFramebuffer(unsigned int index) const override;
+
+	void setOutputFramebuffer(unsigned int index, unsigned int /*GLuint*/ framebuffer);
+
 private:
 
-	const unsigned int m_iDefaultFramebuffer; /*GLuint*/
+	std::vector<unsigned int> m_aOutputFramebuffers; /*GLuint*/
 };
 
 class InstanceWithInternalFramebuffer : public Instance
 {
 public:
 
-	InstanceWithInternalFramebuffer(const std::vector<uint8_t> & bytecode, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures, const std::vector<Value> & values, Framebuffer * pDefaultFramebuffer);
+	InstanceWithInternalFramebuffer(const SharedProgram & program, const std::vector<Operation*> & operations, const std::vector<Framebuffer*> & framebuffers, const std::vector<Texture*> & textures);
 	virtual ~InstanceWithInternalFramebuffer(void) override;
 
 	virtual unsigned int getDefaultFramebuffer(void) const override;
 
-private:
+	virtual bool isUsingDefaultFramebuffer(void) const override;
 
-	const Framebuffer * m_pDefaultFramebuffer; /*GLuint*/
+	virtual unsigned int getOutputFramebuffer(unsigned int index) const override;
 };
 
 }
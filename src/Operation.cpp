@@ -1,8 +1,18 @@
 #include "Operation.h"
 
+#include "VM.h"
+
 namespace RenderGraph
 {
 
+/**
+ * @brief Constructor
+ */
+Operation::Operation(void) : m_state(STATE_UNINITIALIZED), m_iInputCount(0), m_iOutputCount(0)
+{
+	// ...
+}
+
 /**
  * @brief Destructor
  */
@@ -11,4 +21,41 @@ Operation::~Operation()
 	// ...
 }
 
+/**
+ * @brief Run init and publish the result (can be called from any thread able to run init)
+ * @return
+ */
+bool Operation::initialize(void)
+{
+	m_state.store(STATE_INITIALIZING, std::memory_order_release);
+
+	bool success = init();
+
+	m_state.store(success ? STATE_READY : STATE_FAILED, std::memory_order_release);
+
+	return success;
+}
+
+/**
+ * @brief Called instead of execute until the operation is ready
+ * @param parameters
+ * @return
+ */
+bool Operation::fallback(Parameters & parameters)
+{
+	for (unsigned int i = 0; i < m_iInputCount; ++i)
+	{
+		parameters.pop();
+	}
+
+	for (unsigned int i = 0; i < m_iOutputCount; ++i)
+	{
+		Value v;
+		v.asUInt = 0;
+		parameters.push(v);
+	}
+
+	return true;
+}
+
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 namespace RenderGraph
 {
 
@@ -9,8 +11,17 @@ class Operation
 {
 public:
 
+	enum State
+	{
+		STATE_UNINITIALIZED = 0,
+		STATE_INITIALIZING = 1,
+		STATE_READY = 2,
+		STATE_FAILED = 3,
+	};
+
 	//
-	// Destructor
+	// Constructor / Destructor
+	Operation(void);
 	virtual	~Operation(void);
 
 	//
@@ -22,6 +33,38 @@ public:
 	// Execute
 	virtual bool	execute			(Parameters & parameters) = 0;
 
+	//
+	// Execute while not ready (default : consume the inputs, output zeros)
+	virtual bool	fallback		(Parameters & parameters);
+
+	//
+	// Initialization state (init can run on a loader thread, see InitScheduler)
+	bool			initialize		(void);
+
+	State			getState		(void) const
+	{
+		return State(m_state.load(std::memory_order_acquire));
+	}
+
+	bool			isReady			(void) const
+	{
+		return m_state.load(std::memory_order_acquire) == STATE_READY;
+	}
+
+	//
+	// Number of values taken from / left on the stack by execute
+	void			setSignature	(unsigned int inputs, unsigned int outputs)
+	{
+		m_iInputCount = inputs;
+		m_iOutputCount = outputs;
+	}
+
+private:
+
+	std::atomic<int> m_state;
+
+	unsigned int m_iInputCount;
+	unsigned int m_iOutputCount;
 };
 
 }
@@ -5,6 +5,9 @@
 #include "OpenGL.h"
 
 #include <assert.h>
+#include <math.h>
+
+#include <algorithm>
 
 static_assert(sizeof(unsigned int) == sizeof(GLuint), "size of unsigned int must match size of GLuint");
 
@@ -14,7 +17,7 @@ namespace RenderGraph
 /**
  * @brief Constructor
  */
-Pass::Pass(void) : m_loadOp(ATTACHMENT_LOAD_OP_LOAD), m_depthLoadOp(ATTACHMENT_LOAD_OP_LOAD), m_storeOp(ATTACHMENT_STORE_OP_STORE), m_depthStoreOp(ATTACHMENT_STORE_OP_STORE), m_iFramebufferNativeHandle(0), m_iFramebufferWidth(0), m_iFramebufferHeight(0)
+Pass::Pass(void) : m_loadOp(ATTACHMENT_LOAD_OP_LOAD), m_depthLoadOp(ATTACHMENT_LOAD_OP_LOAD), m_storeOp(ATTACHMENT_STORE_OP_STORE), m_depthStoreOp(ATTACHMENT_STORE_OP_STORE), m_iFramebufferNativeHandle(0), m_iFramebufferWidth(0), m_iFramebufferHeight(0), m_fRenderScale(1.0f), m_bScaleViewport(false)
 {
 	m_fClearColorR = 0.0f;
 	m_fClearColorG = 0.0f;
@@ -39,7 +42,6 @@ Pass::~Pass(void)
  */
 bool Pass::init(void)
 {
-	assert(m_iFramebufferNativeHandle == 0);
 	return true;
 }
 
@@ -77,18 +79,21 @@ bool Pass::execute(Parameters & parameters)
  */
 bool Pass::begin(void)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_iFramebufferNativeHandle);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_iFramebufferNativeHandle); // draw buffers are part of the framebuffer state (see FramebufferCache)
 
-	if (m_iFramebufferNativeHandle != 0)
-	{
-		GLenum buffers [4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-		glDrawBuffers(4, buffers); // FIXME
-	}
+	glViewport(0, 0, getViewportWidth(), getViewportHeight());
 
-	glViewport(0, 0, m_iFramebufferWidth, m_iFramebufferHeight);
+	return resume();
+}
 
+/**
+ * @brief Continue rendering into the framebuffer bound by the previous pass (which has the same attachments)
+ */
+bool Pass::resume(void)
+{
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 	glDepthMask(GL_TRUE);
+	glStencilMask(0xFF); // stencil is cleared with depth
 
 	if (m_loadOp == ATTACHMENT_LOAD_OP_CLEAR && m_depthLoadOp == ATTACHMENT_LOAD_OP_CLEAR)
 	{
@@ -119,6 +124,34 @@ bool Pass::begin(void)
 	return true;
 }
 
+/**
+ * @brief Width of the area rendered this frame (rounded up, so that it covers the [0, scale] UV range)
+ * @return
+ */
+unsigned int Pass::getViewportWidth(void) const
+{
+	if (m_bScaleViewport)
+	{
+		return std::max(1u, static_cast<unsigned int>(ceilf(m_iFramebufferWidth * m_fRenderScale)));
+	}
+
+	return m_iFramebufferWidth;
+}
+
+/**
+ * @brief Height of the area rendered this frame (rounded up, so that it covers the [0, scale] UV range)
+ * @return
+ */
+unsigned int Pass::getViewportHeight(void) const
+{
+	if (m_bScaleViewport)
+	{
+		return std::max(1u, static_cast<unsigned int>(ceilf(m_iFramebufferHeight * m_fRenderScale)));
+	}
+
+	return m_iFramebufferHeight;
+}
+
 /**
  * @brief End
  */
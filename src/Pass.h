@@ -21,6 +21,7 @@ public:
 	virtual bool	execute			(Parameters & parameters) override;
 
 	virtual bool	begin			(void);
+	virtual bool	resume			(void);
 	virtual bool	render			(Parameters & parameters) = 0;
 	virtual bool	end				(void);
 
@@ -31,8 +32,24 @@ public:
 		m_iFramebufferHeight = height;
 	}
 
+	inline void setRenderScale(float scale, bool bScaleViewport)
+	{
+		m_fRenderScale = scale;
+		m_bScaleViewport = bScaleViewport;
+	}
+
 protected:
 
+	//
+	// Dynamic resolution : render targets with a relative size are rendered into their [0, scale] corner (see Instance::setRenderScale)
+	float			getRenderScale		(void) const // UV scale to sample these targets
+	{
+		return m_fRenderScale;
+	}
+
+	unsigned int	getViewportWidth	(void) const;
+	unsigned int	getViewportHeight	(void) const;
+
 	enum AttachmentLoadOp
 	{
 		ATTACHMENT_LOAD_OP_LOAD = 0,
@@ -66,6 +83,9 @@ private:
 	unsigned int /*GLuint*/ m_iFramebufferNativeHandle;
 	unsigned int m_iFramebufferWidth;
 	unsigned int m_iFramebufferHeight;
+
+	float m_fRenderScale;
+	bool m_bScaleViewport; // false for the outputs and the targets with a fixed size
 };
 
 }
@@ -0,0 +1,633 @@
+#include "Program.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <assert.h>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+static const uint8_t PROGRAM_MAGIC [4] = { 'R', 'G', 'P', 'G' };
+
+/**
+ * @brief Append-only binary writer (native endianness, 4-byte aligned sections)
+ */
+class BinaryWriter
+{
+public:
+
+	explicit BinaryWriter(std::vector<uint8_t> & buffer) : m_buffer(buffer)
+	{
+		// ...
+	}
+
+	void write(const void * data, size_t size)
+	{
+		const uint8_t * bytes = static_cast<const uint8_t*>(data);
+		m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	}
+
+	void writeUInt(uint32_t value)
+	{
+		write(&value, sizeof(value));
+	}
+
+	void writeString(const std::string & str)
+	{
+		writeUInt(str.size());
+		write(str.data(), str.size());
+		align();
+	}
+
+	void align(void)
+	{
+		while (m_buffer.size() % 4 != 0)
+		{
+			m_buffer.push_back(0);
+		}
+	}
+
+private:
+
+	std::vector<uint8_t> & m_buffer;
+};
+
+/**
+ * @brief Bounds-checked binary reader, matching BinaryWriter
+ */
+class BinaryReader
+{
+public:
+
+	BinaryReader(const uint8_t * data, size_t size) : m_data(data), m_size(size), m_offset(0), m_bValid(true)
+	{
+		// ...
+	}
+
+	const uint8_t * read(size_t size)
+	{
+		if (!m_bValid || size > m_size - m_offset)
+		{
+			m_bValid = false;
+			return nullptr;
+		}
+
+		const uint8_t * data = m_data + m_offset;
+		m_offset += size;
+		return data;
+	}
+
+	uint32_t readUInt(void)
+	{
+		uint32_t value = 0;
+
+		const uint8_t * data = read(sizeof(value));
+
+		if (data != nullptr)
+		{
+			memcpy(&value, data, sizeof(value));
+		}
+
+		return value;
+	}
+
+	std::string readString(void)
+	{
+		uint32_t size = readUInt();
+
+		const uint8_t * data = read(size);
+
+		align();
+
+		if (data == nullptr)
+		{
+			return std::string();
+		}
+
+		return std::string(reinterpret_cast<const char*>(data), size);
+	}
+
+	void align(void)
+	{
+		while (m_bValid && m_offset % 4 != 0)
+		{
+			read(1);
+		}
+	}
+
+	bool isValid(void) const
+	{
+		return m_bValid;
+	}
+
+private:
+
+	const uint8_t * m_data;
+	size_t m_size;
+	size_t m_offset;
+	bool m_bValid;
+};
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Constructor
+ */
+Program::Program(void) : useDefaultFramebuffer(false), inputs(0), outputs(0)
+{
+	// ...
+}
+
+/**
+ * @brief Destructor
+ */
+Program::~Program(void)
+{
+	// ...
+}
+
+/**
+ * @brief Program::clear
+ */
+void Program::clear(void)
+{
+	bytecode.clear();
+	values.clear();
+	textures.clear();
+	operations.clear();
+	framebuffers.clear();
+	invocations.clear();
+	useDefaultFramebuffer = false;
+	presents.clear();
+	inputs = 0;
+	outputs = 0;
+	textureSlots.clear();
+	valueSlots.clear();
+}
+
+/**
+ * @brief Write the binary representation of the program
+ * @param buffer (output)
+ * @return
+ */
+bool Program::serialize(std::vector<uint8_t> & buffer) const
+{
+	buffer.clear();
+
+	BinaryWriter writer(buffer);
+
+	//
+	// Header
+	writer.write(PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+	writer.writeUInt(RENDER_GRAPH_PROGRAM_VERSION);
+	writer.writeUInt(useDefaultFramebuffer ? 1 : 0);
+	writer.writeUInt(presents.size());
+	writer.writeUInt(inputs);
+	writer.writeUInt(outputs);
+	writer.writeUInt(bytecode.size());
+	writer.writeUInt(values.size());
+	writer.writeUInt(textures.size());
+	writer.writeUInt(operations.size());
+	writer.writeUInt(framebuffers.size());
+	writer.writeUInt(invocations.size());
+	writer.writeUInt(textureSlots.size());
+	writer.writeUInt(valueSlots.size());
+
+	//
+	// Bytecode
+	writer.write(bytecode.data(), bytecode.size());
+	writer.align();
+
+	//
+	// Value memory
+	writer.write(values.data(), values.size() * sizeof(Value));
+
+	//
+	// Resources
+	for (const TextureLayout & texture : textures)
+	{
+		Value scale;
+		scale.asFloat = texture.scale;
+
+		writer.writeUInt(texture.format);
+		writer.writeUInt(scale.asUInt);
+		writer.writeUInt(texture.width);
+		writer.writeUInt(texture.height);
+		writer.writeUInt(texture.samples);
+		writer.writeUInt(texture.levels);
+		writer.writeUInt(texture.resolve ? 1 : 0);
+	}
+
+	for (const OperationLayout & operation : operations)
+	{
+		writer.writeString(operation.id);
+		writer.writeString(operation.subtype);
+		writer.writeUInt(operation.inputs);
+		writer.writeUInt(operation.outputs);
+	}
+
+	for (const FramebufferLayout & framebuffer : framebuffers)
+	{
+		writer.writeUInt(framebuffer.operation);
+		writer.writeUInt(framebuffer.textures.size());
+
+		for (unsigned int i = 0; i < framebuffer.textures.size(); ++i)
+		{
+			writer.writeUInt(framebuffer.textures[i]);
+			writer.writeUInt(framebuffer.levels[i]);
+		}
+	}
+
+	for (const PresentLayout & present : presents)
+	{
+		writer.writeString(present.name);
+		writer.writeUInt(present.framebuffer);
+		writer.writeUInt(present.operations.size());
+
+		for (unsigned int operation : present.operations)
+		{
+			writer.writeUInt(operation);
+		}
+	}
+
+	for (const InvocationLayout & invocation : invocations)
+	{
+		writer.writeUInt(invocation.entry);
+		writer.writeUInt(invocation.values);
+		writer.writeUInt(invocation.textures);
+		writer.writeUInt(invocation.operations);
+	}
+
+	//
+	// Name tables
+	for (const std::pair<const std::string, unsigned int> & entry : textureSlots)
+	{
+		writer.writeString(entry.first);
+		writer.writeUInt(entry.second);
+	}
+
+	for (const std::pair<const std::string, std::vector<unsigned int>> & entry : valueSlots)
+	{
+		writer.writeString(entry.first);
+		writer.writeUInt(entry.second.size());
+
+		for (unsigned int index : entry.second)
+		{
+			writer.writeUInt(index);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Check that every index of a program refers to something in the program (the data read may be corrupted)
+ * @param program
+ * @return false on the first invalid index
+ */
+static bool CheckIndices(const Program & program)
+{
+	for (const FramebufferLayout & framebuffer : program.framebuffers)
+	{
+		if (framebuffer.levels.size() != framebuffer.textures.size() || framebuffer.operation >= program.operations.size())
+		{
+			return false;
+		}
+
+		for (unsigned int texture : framebuffer.textures)
+		{
+			if (texture >= program.textures.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	for (const PresentLayout & present : program.presents)
+	{
+		if (!program.useDefaultFramebuffer && present.framebuffer >= program.framebuffers.size())
+		{
+			return false;
+		}
+
+		for (unsigned int operation : present.operations)
+		{
+			if (operation >= program.operations.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	for (const InvocationLayout & invocation : program.invocations)
+	{
+		if (invocation.entry >= program.bytecode.size())
+		{
+			return false;
+		}
+
+		// Bases can be the end of a vector (subgraph without values, textures or operations)
+		if (invocation.values > program.values.size() || invocation.textures > program.textures.size() || invocation.operations > program.operations.size())
+		{
+			return false;
+		}
+	}
+
+	for (const std::pair<const std::string, unsigned int> & slot : program.textureSlots)
+	{
+		if (slot.second >= program.textures.size())
+		{
+			return false;
+		}
+	}
+
+	for (const std::pair<const std::string, std::vector<unsigned int>> & slot : program.valueSlots)
+	{
+		for (unsigned int index : slot.second)
+		{
+			if (index >= program.values.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Read a program from its binary representation
+ * @param data
+ * @param size
+ * @return false if the data is not a valid program (or was written by another version)
+ */
+bool Program::deserialize(const uint8_t * data, size_t size)
+{
+	clear();
+
+	BinaryReader reader(data, size);
+
+	//
+	// Header
+	const uint8_t * magic = reader.read(sizeof(PROGRAM_MAGIC));
+
+	if (magic == nullptr || memcmp(magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC)) != 0)
+	{
+		return false;
+	}
+
+	if (reader.readUInt() != RENDER_GRAPH_PROGRAM_VERSION)
+	{
+		return false;
+	}
+
+	useDefaultFramebuffer = (reader.readUInt() != 0);
+	uint32_t presentCount = reader.readUInt();
+	inputs = reader.readUInt();
+	outputs = reader.readUInt();
+
+	uint32_t bytecodeSize = reader.readUInt();
+	uint32_t valueCount = reader.readUInt();
+	uint32_t textureCount = reader.readUInt();
+	uint32_t operationCount = reader.readUInt();
+	uint32_t framebufferCount = reader.readUInt();
+	uint32_t invocationCount = reader.readUInt();
+	uint32_t textureSlotCount = reader.readUInt();
+	uint32_t valueSlotCount = reader.readUInt();
+
+	//
+	// Bytecode
+	const uint8_t * code = reader.read(bytecodeSize);
+
+	if (code == nullptr)
+	{
+		return false;
+	}
+
+	bytecode.assign(code, code + bytecodeSize);
+	reader.align();
+
+	//
+	// Value memory
+	const uint8_t * memory = reader.read(size_t(valueCount) * sizeof(Value));
+
+	if (memory == nullptr)
+	{
+		return false;
+	}
+
+	values.resize(valueCount);
+	memcpy(values.data(), memory, size_t(valueCount) * sizeof(Value));
+
+	//
+	// Resources
+	for (uint32_t i = 0; i < textureCount && reader.isValid(); ++i)
+	{
+		TextureLayout texture;
+		texture.format = TextureFormat(reader.readUInt());
+
+		Value scale;
+		scale.asUInt = reader.readUInt();
+		texture.scale = scale.asFloat;
+
+		texture.width = reader.readUInt();
+		texture.height = reader.readUInt();
+		texture.samples = reader.readUInt();
+		texture.levels = reader.readUInt();
+		texture.resolve = (reader.readUInt() != 0);
+
+		textures.push_back(texture);
+	}
+
+	for (uint32_t i = 0; i < operationCount && reader.isValid(); ++i)
+	{
+		OperationLayout operation;
+		operation.id = reader.readString();
+		operation.subtype = reader.readString();
+		operation.inputs = reader.readUInt();
+		operation.outputs = reader.readUInt();
+		operations.push_back(operation);
+	}
+
+	for (uint32_t i = 0; i < framebufferCount && reader.isValid(); ++i)
+	{
+		FramebufferLayout framebuffer;
+		framebuffer.operation = reader.readUInt();
+
+		uint32_t count = reader.readUInt();
+
+		for (uint32_t j = 0; j < count && reader.isValid(); ++j)
+		{
+			framebuffer.textures.push_back(reader.readUInt());
+			framebuffer.levels.push_back(reader.readUInt());
+		}
+
+		framebuffers.push_back(framebuffer);
+	}
+
+	for (uint32_t i = 0; i < presentCount && reader.isValid(); ++i)
+	{
+		PresentLayout present;
+		present.name = reader.readString();
+		present.framebuffer = reader.readUInt();
+
+		uint32_t count = reader.readUInt();
+
+		for (uint32_t j = 0; j < count && reader.isValid(); ++j)
+		{
+			present.operations.push_back(reader.readUInt());
+		}
+
+		presents.push_back(present);
+	}
+
+	for (uint32_t i = 0; i < invocationCount && reader.isValid(); ++i)
+	{
+		InvocationLayout invocation;
+		invocation.entry = reader.readUInt();
+		invocation.values = reader.readUInt();
+		invocation.textures = reader.readUInt();
+		invocation.operations = reader.readUInt();
+		invocations.push_back(invocation);
+	}
+
+	//
+	// Name tables
+	for (uint32_t i = 0; i < textureSlotCount && reader.isValid(); ++i)
+	{
+		std::string strId = reader.readString();
+		textureSlots.insert(std::pair<std::string, unsigned int>(strId, reader.readUInt()));
+	}
+
+	for (uint32_t i = 0; i < valueSlotCount && reader.isValid(); ++i)
+	{
+		std::string strId = reader.readString();
+
+		std::vector<unsigned int> indices;
+
+		uint32_t count = reader.readUInt();
+
+		for (uint32_t j = 0; j < count && reader.isValid(); ++j)
+		{
+			indices.push_back(reader.readUInt());
+		}
+
+		valueSlots.insert(std::pair<std::string, std::vector<unsigned int>>(strId, indices));
+	}
+
+	if (!reader.isValid() || !CheckIndices(*this))
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Write the program to a file
+ * @param path
+ * @return
+ */
+bool Program::saveToFile(const char * path) const
+{
+	std::vector<uint8_t> buffer;
+
+	if (!serialize(buffer))
+	{
+		return false;
+	}
+
+	FILE * file = fopen(path, "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	bool success = (fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size());
+
+	success = (fclose(file) == 0) && success;
+
+	return success;
+}
+
+/**
+ * @brief Load a program by mapping the file in memory
+ * @param path
+ * @return
+ */
+bool Program::loadFromFile(const char * path)
+{
+	bool success = false;
+
+#if defined(_WIN32)
+
+	HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+
+	if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+	{
+		HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (hMapping != nullptr)
+		{
+			const void * data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+			if (data != nullptr)
+			{
+				success = deserialize(static_cast<const uint8_t*>(data), size_t(size.QuadPart));
+				UnmapViewOfFile(data);
+			}
+
+			CloseHandle(hMapping);
+		}
+	}
+
+	CloseHandle(hFile);
+
+#else
+
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void * data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data != MAP_FAILED)
+		{
+			success = deserialize(static_cast<const uint8_t*>(data), size_t(st.st_size));
+			munmap(data, st.st_size);
+		}
+	}
+
+	close(fd);
+
+#endif
+
+	return success;
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+
+#include "VM.h"
+#include "Formats.h"
+
+namespace RenderGraph
+{
+
+#define RENDER_GRAPH_PROGRAM_VERSION 9
+
+/**
+ * @brief Render target to create : format, size relative to the instance or fixed, number of samples and mip levels
+ */
+struct TextureLayout
+{
+	TextureFormat format;
+	float scale; // size relative to the instance (when width and height are 0)
+	unsigned int width; // fixed size (0 : relative size)
+	unsigned int height;
+	unsigned int samples; // 1 : single-sample
+	unsigned int levels; // mip chain (1 : level 0 only)
+	bool resolve; // multisample content read after rendering (a single-sample copy is made by RESOLVE)
+};
+
+/**
+ * @brief Operation to create, and the number of values it takes from / leaves on the stack
+ */
+struct OperationLayout
+{
+	std::string id; // pass node id
+	std::string subtype;
+	unsigned int inputs;
+	unsigned int outputs;
+};
+
+/**
+ * @brief Attachments of a framebuffer, and the pass rendering into it
+ */
+struct FramebufferLayout
+{
+	std::vector<unsigned int> textures; // indices in Program::textures
+	std::vector<unsigned int> levels; // mip level rendered, for each texture
+	unsigned int operation; // index in Program::operations
+};
+
+/**
+ * @brief Output of a graph (present node) : the passes rendering it, and their framebuffer
+ */
+struct PresentLayout
+{
+	std::string name; // present node id
+	std::vector<unsigned int> operations; // passes rendering the output (into the framebuffer of the application when useDefaultFramebuffer is true)
+	unsigned int framebuffer; // index in Program::framebuffers (when useDefaultFramebuffer is false)
+};
+
+/**
+ * @brief Use site of a subgraph : where its code starts, and where its resources start relative to the invoking code
+ */
+struct InvocationLayout
+{
+	unsigned int entry; // offset in Program::bytecode
+	unsigned int values; // base added to value addresses
+	unsigned int textures; // base added to texture addresses
+	unsigned int operations; // base added to operation indices
+};
+
+/**
+ * @brief Compiled render graph : everything needed to create an Instance, without the graph
+ */
+class Program
+{
+public:
+
+	Program(void);
+	~Program(void);
+
+	void clear(void);
+
+	bool serialize(std::vector<uint8_t> & buffer) const;
+	bool deserialize(const uint8_t * data, size_t size);
+
+	bool saveToFile(const char * path) const;
+	bool loadFromFile(const char * path);
+
+	std::vector<uint8_t> bytecode;
+	std::vector<Value> values; // initial value memory
+
+	std::vector<TextureLayout> textures;
+	std::vector<OperationLayout> operations;
+	std::vector<FramebufferLayout> framebuffers;
+
+	std::vector<InvocationLayout> invocations; // operand of INVOKE -> subgraph use site
+
+	bool useDefaultFramebuffer; // the final passes render into framebuffers provided by the application
+	std::vector<PresentLayout> presents; // outputs, sorted by name (the first one is the default framebuffer)
+
+	unsigned int inputs; // values popped by a subgraph when invoked (0 for a graph with a present node)
+	unsigned int outputs; // values pushed by a subgraph when it returns
+
+	std::map<std::string, unsigned int> textureSlots; // node id -> index in textures
+	std::map<std::string, std::vector<unsigned int>> valueSlots; // node id -> indices in values
+};
+
+/**
+ * @brief Program shared by the instances created from it (immutable, each instance owns its value memory and resources)
+ */
+typedef std::shared_ptr<const Program> SharedProgram;
+
+}
@@ -5,3 +5,9 @@
 #include "Instance.h"
 
 #include "Factory.h"
+
+#include "Diagnostics.h"
+
+#include "Program.h"
+
+#include "Scheduler.h"
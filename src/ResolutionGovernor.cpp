@@ -0,0 +1,158 @@
+#include "ResolutionGovernor.h"
+
+#include "OpenGL.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+#define SMOOTHING 0.2f // weight of the last measure
+#define MAX_SCALE_UP 1.05f // per adjustment, going up too fast oscillates around the budget
+#define MIN_SCALE_CHANGE 0.01f
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Constructor
+ * @param targetTime GPU time budget of a frame, in milliseconds
+ * @param minScale
+ * @param maxScale
+ * @param hysteresis fraction of the budget under which the scale goes up (e.g. 0.1)
+ */
+ResolutionGovernor::ResolutionGovernor(float targetTime, float minScale, float maxScale, float hysteresis)
+	: m_iFirstPending(0),
+	  m_iPendingCount(0),
+	  m_bMeasuring(false),
+	  m_fTargetTime(targetTime),
+	  m_fMinScale(minScale),
+	  m_fMaxScale(maxScale),
+	  m_fHysteresis(hysteresis),
+	  m_fGpuTime(0.0f),
+	  m_iSkipCount(0)
+{
+	assert(targetTime > 0.0f);
+	assert(minScale > 0.0f && minScale <= maxScale && maxScale <= 1.0f);
+
+	for (unsigned int i = 0; i < RENDER_GRAPH_GOVERNOR_LATENCY; ++i)
+	{
+		m_aQueries[i] = 0;
+	}
+}
+
+/**
+ * @brief Destructor
+ */
+ResolutionGovernor::~ResolutionGovernor(void)
+{
+	if (m_aQueries[0] != 0)
+	{
+		glDeleteQueries(RENDER_GRAPH_GOVERNOR_LATENCY, m_aQueries);
+	}
+}
+
+/**
+ * @brief Start measuring a frame
+ */
+void ResolutionGovernor::begin(void)
+{
+	if (m_aQueries[0] == 0)
+	{
+		glGenQueries(RENDER_GRAPH_GOVERNOR_LATENCY, m_aQueries);
+	}
+
+	m_bMeasuring = m_iPendingCount < RENDER_GRAPH_GOVERNOR_LATENCY; // otherwise the GPU is more than LATENCY frames behind, skip this one
+
+	if (m_bMeasuring)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_aQueries[(m_iFirstPending + m_iPendingCount) % RENDER_GRAPH_GOVERNOR_LATENCY]);
+	}
+}
+
+/**
+ * @brief Stop measuring a frame, and adjust the scale with the measures available (never waits for the GPU)
+ * @param scale (in/out) render scale
+ * @return true if the scale changed
+ */
+bool ResolutionGovernor::end(float & scale)
+{
+	if (m_bMeasuring)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		++m_iPendingCount;
+		m_bMeasuring = false;
+	}
+
+	bool bUpdated = false;
+
+	while (m_iPendingCount > 0)
+	{
+		const GLuint query = m_aQueries[m_iFirstPending];
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (available == GL_FALSE)
+		{
+			break; // queries complete in order
+		}
+
+		GLuint64 elapsed = 0; // in nanoseconds
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+		m_iFirstPending = (m_iFirstPending + 1) % RENDER_GRAPH_GOVERNOR_LATENCY;
+		--m_iPendingCount;
+
+		if (m_iSkipCount > 0)
+		{
+			--m_iSkipCount;
+			continue;
+		}
+
+		const float time = float(elapsed) * 1e-6f;
+
+		m_fGpuTime = (m_fGpuTime > 0.0f) ? (m_fGpuTime + (time - m_fGpuTime) * SMOOTHING) : time;
+
+		bUpdated = true;
+	}
+
+	if (!bUpdated || m_fGpuTime <= 0.0f)
+	{
+		return false;
+	}
+
+	if (m_fGpuTime <= m_fTargetTime && m_fGpuTime >= m_fTargetTime * (1.0f - m_fHysteresis))
+	{
+		return false; // in the budget
+	}
+
+	// GPU time is roughly proportional to the number of pixels, i.e. to scale²
+	float newScale = scale * sqrtf(m_fTargetTime / m_fGpuTime);
+
+	newScale = std::min(newScale, scale * MAX_SCALE_UP);
+	newScale = std::max(m_fMinScale, std::min(m_fMaxScale, newScale));
+
+	if (fabsf(newScale - scale) < MIN_SCALE_CHANGE)
+	{
+		return false;
+	}
+
+	scale = newScale;
+
+	m_fGpuTime = 0.0f; // measure again at the new scale
+	m_iSkipCount = m_iPendingCount; // frames in flight were rendered at the old one
+
+	return true;
+}
+
+/**
+ * @brief Smoothed GPU time of the last frames, in milliseconds (0 until a frame was measured at the current scale)
+ * @return
+ */
+float ResolutionGovernor::getGpuTime(void) const
+{
+	return m_fGpuTime;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+namespace RenderGraph
+{
+
+#define RENDER_GRAPH_GOVERNOR_LATENCY 4 // frames in flight before a timer query is read
+
+/**
+ * @brief Adjusts the render scale of an instance (see Instance::setRenderScale) to keep its GPU time in a frame budget
+ *
+ * The GPU time of each frame is measured with a GL_TIME_ELAPSED query, read a few frames later without stalling.
+ * Over the budget the scale goes down at once, under (1 - hysteresis) of the budget it goes back up slowly.
+ * Timer queries can't be nested : the application must not measure around Instance::execute with its own GL_TIME_ELAPSED query.
+ *
+ * Must be used on the thread owning the GL context.
+ */
+class ResolutionGovernor
+{
+public:
+
+	ResolutionGovernor(float targetTime, float minScale, float maxScale, float hysteresis);
+	~ResolutionGovernor(void);
+
+	void begin(void);
+	bool end(float & scale);
+
+	float getGpuTime(void) const;
+
+private:
+
+	unsigned int /*GLuint*/ m_aQueries [RENDER_GRAPH_GOVERNOR_LATENCY];
+	unsigned int m_iFirstPending; // oldest query not read yet
+	unsigned int m_iPendingCount;
+	bool m_bMeasuring; // a query was started by begin (not when all the queries are in flight)
+
+	float m_fTargetTime; // in milliseconds
+	float m_fMinScale;
+	float m_fMaxScale;
+	float m_fHysteresis;
+
+	float m_fGpuTime; // smoothed, in milliseconds (0 : no measure at the current scale yet)
+	unsigned int m_iSkipCount; // queries still measuring frames rendered at the previous scale
+};
+
+}
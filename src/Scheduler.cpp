@@ -0,0 +1,132 @@
+#include "Scheduler.h"
+
+#include "Operation.h"
+
+#include <assert.h>
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Destructor
+ */
+InitScheduler::~InitScheduler(void)
+{
+	// ...
+}
+
+/**
+ * @brief Constructor
+ * @param threadCount
+ * @param threadStart called on each worker thread before any initialization (e.g. to make a shared context current)
+ * @param threadStop called on each worker thread before it exits
+ * @param user passed to the callbacks
+ */
+InitThreadPool::InitThreadPool(unsigned int threadCount, ThreadCallback threadStart, ThreadCallback threadStop, void * user)
+	: m_iBusyCount(0),
+	  m_bStop(false),
+	  m_threadStart(threadStart),
+	  m_threadStop(threadStop),
+	  m_pUser(user)
+{
+	assert(threadCount > 0);
+
+	m_aThreads.reserve(threadCount);
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		m_aThreads.push_back(std::thread(&InitThreadPool::run, this));
+	}
+}
+
+/**
+ * @brief Destructor (finishes the pending initializations)
+ */
+InitThreadPool::~InitThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+
+	m_condition.notify_all();
+
+	for (std::thread & thread : m_aThreads)
+	{
+		thread.join();
+	}
+}
+
+/**
+ * @brief Queue the initialization of an operation
+ * @param operation
+ */
+void InitThreadPool::schedule(Operation * operation)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(operation);
+	}
+
+	m_condition.notify_one();
+}
+
+/**
+ * @brief Block until all queued initializations are done
+ */
+void InitThreadPool::wait(void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_idleCondition.wait(lock, [this] { return m_queue.empty() && m_iBusyCount == 0; });
+}
+
+/**
+ * @brief Worker thread
+ */
+void InitThreadPool::run(void)
+{
+	if (m_threadStart != nullptr)
+	{
+		m_threadStart(m_pUser);
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_condition.wait(lock, [this] { return m_bStop || !m_queue.empty(); });
+
+		if (m_queue.empty())
+		{
+			break; // stopping, and nothing left to do
+		}
+
+		Operation * operation = m_queue.front();
+		m_queue.pop_front();
+
+		++m_iBusyCount;
+
+		lock.unlock();
+
+		operation->initialize();
+
+		lock.lock();
+
+		--m_iBusyCount;
+
+		if (m_queue.empty() && m_iBusyCount == 0)
+		{
+			m_idleCondition.notify_all();
+		}
+	}
+
+	lock.unlock();
+
+	if (m_threadStop != nullptr)
+	{
+		m_threadStop(m_pUser);
+	}
+}
+
+}
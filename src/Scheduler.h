@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace RenderGraph
+{
+
+class Operation;
+
+/**
+ * @brief Runs Operation::initialize away from the thread creating the instance
+ * Implementations must call operation->initialize() exactly once, on a thread where init can run
+ * (for passes compiling shaders : a thread with a context shared with the render context)
+ */
+class InitScheduler
+{
+public:
+
+	virtual ~InitScheduler(void);
+
+	virtual void schedule(Operation * operation) = 0;
+};
+
+/**
+ * @brief InitScheduler running initializations on a pool of worker threads
+ */
+class InitThreadPool : public InitScheduler
+{
+public:
+
+	typedef void (*ThreadCallback)(void * user);
+
+	InitThreadPool(unsigned int threadCount, ThreadCallback threadStart = nullptr, ThreadCallback threadStop = nullptr, void * user = nullptr);
+	virtual ~InitThreadPool(void) override;
+
+	virtual void schedule(Operation * operation) override;
+
+	void wait(void);
+
+private:
+
+	void run(void);
+
+	std::vector<std::thread> m_aThreads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::condition_variable m_idleCondition;
+
+	std::deque<Operation*> m_queue;
+	unsigned int m_iBusyCount;
+	bool m_bStop;
+
+	ThreadCallback m_threadStart;
+	ThreadCallback m_threadStop;
+	void * m_pUser;
+};
+
+}
@@ -1,195 +1,211 @@
 #include "Texture.h"
 
+#include "TexturePool.h"
+
 #include "OpenGL.h"
 
 #include <assert.h>
 
+#include <algorithm>
+
 namespace RenderGraph
 {
 
 /**
  * @brief Constructor
- * @param format
+ * @param layout format, size and number of samples
+ * @param pool storage of the texture
  */
-Texture::Texture(TextureFormat format_) : format(format_), currentWidth(0), currentHeight(0)
+Texture::Texture(const TextureLayout & layout, const std::shared_ptr<TexturePool> & pool_) : format(layout.format), scale(layout.scale), fixedWidth(layout.width), fixedHeight(layout.height), samples(layout.samples), resolved(layout.samples > 1 && layout.resolve), levels(layout.levels), pool(pool_), currentWidth(0), currentHeight(0), currentLevels(0), storage(0)
 {
+	assert(pool);
+	assert(samples > 0 && levels > 0);
 	textureId = 0;
+	multisampleTextureId = 0;
+	resolveFramebuffers[0] = resolveFramebuffers[1] = 0;
 }
 
 /**
  * @brief Destructor
  */
 Texture::~Texture(void)
+{
+	if (resolveFramebuffers[0] != 0)
+	{
+		glDeleteFramebuffers(2, resolveFramebuffers);
+	}
+
+	release();
+}
+
+/**
+ * @brief Give the storage back to the pool
+ */
+void Texture::release(void)
 {
 	if (textureId != 0)
 	{
-		glDeleteTextures(1, &textureId);
+		pool->release(textureId, format, currentWidth, currentHeight, 1, currentLevels);
 		textureId = 0;
 	}
+
+	if (multisampleTextureId != 0)
+	{
+		pool->release(multisampleTextureId, format, currentWidth, currentHeight, samples);
+		multisampleTextureId = 0;
+	}
 }
 
 /**
- * @brief Resize texture
- * @param width
- * @param height
+ * @brief Resize texture (the previous storage goes back to the pool)
+ * @param instanceWidth size of the instance, scaled unless the texture has a fixed size
+ * @param instanceHeight
  * @return
  */
-bool Texture::resize(unsigned int width, unsigned int height)
+bool Texture::resize(unsigned int instanceWidth, unsigned int instanceHeight)
 {
-	if (textureId != 0)
+	unsigned int width = fixedWidth;
+	unsigned int height = fixedHeight;
+
+	if (width == 0 || height == 0)
 	{
-		glDeleteTextures(1, &textureId);
-		textureId = 0;
+		width = std::max(1u, static_cast<unsigned int>(float(instanceWidth) * scale + 0.5f));
+		height = std::max(1u, static_cast<unsigned int>(float(instanceHeight) * scale + 0.5f));
 	}
 
-	glGenTextures(1, &textureId);
+	if (getRenderHandle() != 0 && width == currentWidth && height == currentHeight)
+	{
+		return true;
+	}
 
-	glBindTexture(GL_TEXTURE_2D, textureId);
+	release();
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic error "-Wswitch"
+	++storage;
 
-	switch (format)
+	currentWidth = width;
+	currentHeight = height;
+	currentLevels = 1;
+
+	if (samples == 1)
 	{
-		case UNKNOWN:
+		while (currentLevels < levels && std::max(width, height) >> currentLevels > 0)
 		{
-			assert(false);
+			++currentLevels; // down to 1x1
 		}
-		break;
 
-		case R8:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
-		}
-		break;
+		textureId = pool->acquire(format, width, height, 1, currentLevels);
 
-		case RG8:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
-		}
-		break;
+		return textureId != 0;
+	}
 
-		case RGBA8:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		}
-		break;
+	multisampleTextureId = pool->acquire(format, width, height, samples);
 
-		case R16:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, width, height, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
-		}
-		break;
+	if (!resolved)
+	{
+		return multisampleTextureId != 0; // only read by the pass rendering it (e.g. a depth buffer)
+	}
 
-		case RG16:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, width, height, 0, GL_RG, GL_UNSIGNED_SHORT, nullptr);
-		}
-		break;
+	textureId = pool->acquire(format, width, height);
 
-		case RGBA16:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16, width, height, 0, GL_RGBA, GL_UNSIGNED_SHORT, nullptr);
-		}
-		break;
+	if (multisampleTextureId == 0 || textureId == 0)
+	{
+		return false;
+	}
 
-		case R16F:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
-		}
-		break;
+	if (resolveFramebuffers[0] == 0)
+	{
+		glGenFramebuffers(2, resolveFramebuffers);
+	}
 
-		case RG16F:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
-		}
-		break;
+	GLenum attachment = GL_COLOR_ATTACHMENT0;
 
-		case RGBA16F:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-		}
-		break;
-
-		case R32F:
-		case RG32F:
-		case RGBA32F:
-		case R8I:
-		case RG8I:
-		case RGBA8I:
-		case R16I:
-		case RG16I:
-		case RGBA16I:
-		case R32I:
-		case RG32I:
-		case RGBA32I:
-		case R8UI:
-		case RG8UI:
-		case RGBA8UI:
-		case R16UI:
-		case RG16UI:
-		case RGBA16UI:
-		case R32UI:
-		case RG32UI:
-		case RGBA32UI:
-		case RGB10_A2:
-		case RGB10_A2UI:
-		case R11F_G11F_B10F:
-		case SRGB8_ALPHA8:
-		{
-			assert(false); // TODO
-		}
-		break;
+	if (isDepthTexture())
+	{
+		attachment = GL_DEPTH_ATTACHMENT;
+	}
+	else if (isStencilTexture())
+	{
+		attachment = GL_STENCIL_ATTACHMENT;
+	}
+	else if (isDepthStencilTexture())
+	{
+		attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+	}
 
-		case DEPTH_COMPONENT16:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT16, GL_FLOAT, nullptr);
-		}
-		break;
+	glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffers[0]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D_MULTISAMPLE, multisampleTextureId, 0);
 
-		case DEPTH_COMPONENT24:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT24, GL_FLOAT, nullptr);
-		}
-		break;
+	glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffers[1]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, textureId, 0);
 
-		case DEPTH_COMPONENT32F:
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-		}
-		break;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-		case DEPTH24_STENCIL8:
-		case DEPTH32F_STENCIL8:
-		case STENCIL_INDEX8:
-		{
-			assert(false); // TODO
-		}
-		break;
+	return true;
+}
+
+/**
+ * @brief Copy the multisample texture into the texture read by the passes (averaging the samples of color textures)
+ * @return false if the texture has no single-sample copy
+ */
+bool Texture::resolve(void)
+{
+	if (!resolved || resolveFramebuffers[0] == 0)
+	{
+		return false;
 	}
 
-#pragma GCC diagnostic pop
+	GLbitfield mask = GL_COLOR_BUFFER_BIT;
 
-	assert(glGetError() == GL_NO_ERROR);
+	if (isDepthTexture())
+	{
+		mask = GL_DEPTH_BUFFER_BIT;
+	}
+	else if (isStencilTexture())
+	{
+		mask = GL_STENCIL_BUFFER_BIT;
+	}
+	else if (isDepthStencilTexture())
+	{
+		mask = GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+	}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffers[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffers[1]);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glBlitFramebuffer(0, 0, currentWidth, currentHeight, 0, 0, currentWidth, currentHeight, mask, GL_NEAREST);
 
-	currentWidth = width;
-	currentHeight = height;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	assert(glGetError() == GL_NO_ERROR);
 
 	return true;
 }
 
+/**
+ * @brief Format, size policy, number of samples and mip levels of the texture
+ * @return
+ */
+TextureLayout Texture::getLayout(void) const
+{
+	TextureLayout layout;
+	layout.format = format;
+	layout.scale = scale;
+	layout.width = fixedWidth;
+	layout.height = fixedHeight;
+	layout.samples = samples;
+	layout.levels = levels;
+	layout.resolve = resolved;
+	return(layout);
+}
+
 /**
  * @brief Texture::isColorTexture
  * @return
  */
 bool Texture::isColorTexture(void) const
 {
-	return !isDepthTexture() && !isStencilTexture();
+	return !isDepthTexture() && !isStencilTexture() && !isDepthStencilTexture();
 }
 
 /**
@@ -1,20 +1,27 @@
 #pragma once
 
 #include "Formats.h"
+#include "Program.h"
+
+#include <memory>
 
 namespace RenderGraph
 {
 
+class TexturePool;
+
 class Texture
 {
 
 public:
 
-	Texture(TextureFormat format);
+	Texture(const TextureLayout & layout, const std::shared_ptr<TexturePool> & pool);
 	~Texture(void);
 
 	bool resize(unsigned int width, unsigned int height);
 
+	bool resolve(void);
+
 	bool isColorTexture(void) const;
 	bool isDepthTexture(void) const;
 	bool isStencilTexture(void) const;
@@ -23,19 +30,70 @@ public:
 	unsigned int getWidth(void) const;
 	unsigned int getHeight(void) const;
 
-	unsigned int /*GLuint*/ getNativeHandle(void) const
+	TextureFormat getFormat(void) const
+	{
+		return(format);
+	}
+
+	TextureLayout getLayout(void) const;
+
+	bool hasRelativeSize(void) const
+	{
+		return(fixedWidth == 0 || fixedHeight == 0);
+	}
+
+	unsigned int getSamples(void) const
+	{
+		return(samples);
+	}
+
+	unsigned int getLevels(void) const // mip levels allocated (fewer than requested when the texture is too small)
+	{
+		return(currentLevels);
+	}
+
+	unsigned int /*GLuint*/ getNativeHandle(void) const // texture read by the passes (the resolved copy of a multisample texture)
 	{
 		return(textureId);
 	}
 
+	unsigned int /*GLuint*/ getRenderHandle(void) const // texture rendered into
+	{
+		return((samples > 1) ? multisampleTextureId : textureId);
+	}
+
+	unsigned int getStorage(void) const // changes each time the texture gets new storage (unlike the GL names, which the driver can reuse)
+	{
+		return(storage);
+	}
+
 private:
 
+	void release(void);
+
 	TextureFormat format;
 
+	float scale; // size relative to the instance
+	unsigned int fixedWidth; // or fixed size
+	unsigned int fixedHeight;
+
+	unsigned int samples;
+	bool resolved; // multisample texture with a single-sample copy
+
+	unsigned int levels; // mip levels requested
+
+	std::shared_ptr<TexturePool> pool;
+
 	unsigned int currentWidth;
 	unsigned int currentHeight;
+	unsigned int currentLevels;
+
+	unsigned int storage; // generation of the storage, 0 : none yet
 
 	unsigned int /*GLuint*/ textureId;
+	unsigned int /*GLuint*/ multisampleTextureId;
+
+	unsigned int /*GLuint*/ resolveFramebuffers [2]; // read (multisample), draw (single-sample)
 };
 
 }
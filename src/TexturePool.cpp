@@ -0,0 +1,472 @@
+#include "TexturePool.h"
+
+#include "OpenGL.h"
+
+#include <assert.h>
+
+#include <iterator>
+#include <algorithm>
+
+/**
+ * @brief Size of a texture
+ * @param format
+ * @param width
+ * @param height
+ * @param samples
+ * @param levels
+ * @return bytes
+ */
+static size_t GetTextureSize(RenderGraph::TextureFormat format, unsigned int width, unsigned int height, unsigned int samples, unsigned int levels)
+{
+	size_t size = 0;
+
+	for (unsigned int level = 0; level < levels; ++level)
+	{
+		const size_t levelWidth = std::max(1u, width >> level);
+		const size_t levelHeight = std::max(1u, height >> level);
+
+		size += levelWidth * levelHeight * size_t(samples) * RenderGraph::getBytesPerPixel(format);
+	}
+
+	return(size);
+}
+
+/**
+ * @brief Internal format of a texture : the exact format requested (depth 16 / 24 bits are not promoted to 32F)
+ * @param format
+ * @return
+ */
+static GLenum GetInternalFormat(RenderGraph::TextureFormat format)
+{
+	using namespace RenderGraph;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Wswitch"
+
+	switch (format)
+	{
+		case UNKNOWN:
+		{
+			assert(false);
+		}
+		break;
+
+		case R8:
+		{
+			return(GL_R8);
+		}
+		break;
+
+		case RG8:
+		{
+			return(GL_RG8);
+		}
+		break;
+
+		case RGBA8:
+		{
+			return(GL_RGBA8);
+		}
+		break;
+
+		case R16:
+		{
+			return(GL_R16);
+		}
+		break;
+
+		case RG16:
+		{
+			return(GL_RG16);
+		}
+		break;
+
+		case RGBA16:
+		{
+			return(GL_RGBA16);
+		}
+		break;
+
+		case R16F:
+		{
+			return(GL_R16F);
+		}
+		break;
+
+		case RG16F:
+		{
+			return(GL_RG16F);
+		}
+		break;
+
+		case RGBA16F:
+		{
+			return(GL_RGBA16F);
+		}
+		break;
+
+		case R32F:
+		{
+			return(GL_R32F);
+		}
+		break;
+
+		case RG32F:
+		{
+			return(GL_RG32F);
+		}
+		break;
+
+		case RGBA32F:
+		{
+			return(GL_RGBA32F);
+		}
+		break;
+
+		case R8I:
+		{
+			return(GL_R8I);
+		}
+		break;
+
+		case RG8I:
+		{
+			return(GL_RG8I);
+		}
+		break;
+
+		case RGBA8I:
+		{
+			return(GL_RGBA8I);
+		}
+		break;
+
+		case R16I:
+		{
+			return(GL_R16I);
+		}
+		break;
+
+		case RG16I:
+		{
+			return(GL_RG16I);
+		}
+		break;
+
+		case RGBA16I:
+		{
+			return(GL_RGBA16I);
+		}
+		break;
+
+		case R32I:
+		{
+			return(GL_R32I);
+		}
+		break;
+
+		case RG32I:
+		{
+			return(GL_RG32I);
+		}
+		break;
+
+		case RGBA32I:
+		{
+			return(GL_RGBA32I);
+		}
+		break;
+
+		case R8UI:
+		{
+			return(GL_R8UI);
+		}
+		break;
+
+		case RG8UI:
+		{
+			return(GL_RG8UI);
+		}
+		break;
+
+		case RGBA8UI:
+		{
+			return(GL_RGBA8UI);
+		}
+		break;
+
+		case R16UI:
+		{
+			return(GL_R16UI);
+		}
+		break;
+
+		case RG16UI:
+		{
+			return(GL_RG16UI);
+		}
+		break;
+
+		case RGBA16UI:
+		{
+			return(GL_RGBA16UI);
+		}
+		break;
+
+		case R32UI:
+		{
+			return(GL_R32UI);
+		}
+		break;
+
+		case RG32UI:
+		{
+			return(GL_RG32UI);
+		}
+		break;
+
+		case RGBA32UI:
+		{
+			return(GL_RGBA32UI);
+		}
+		break;
+
+		case RGB10_A2:
+		{
+			return(GL_RGB10_A2);
+		}
+		break;
+
+		case RGB10_A2UI:
+		{
+			return(GL_RGB10_A2UI);
+		}
+		break;
+
+		case R11F_G11F_B10F:
+		{
+			return(GL_R11F_G11F_B10F);
+		}
+		break;
+
+		case SRGB8_ALPHA8:
+		{
+			return(GL_SRGB8_ALPHA8);
+		}
+		break;
+
+		case DEPTH_COMPONENT16:
+		{
+			return(GL_DEPTH_COMPONENT16);
+		}
+		break;
+
+		case DEPTH_COMPONENT24:
+		{
+			return(GL_DEPTH_COMPONENT24);
+		}
+		break;
+
+		case DEPTH_COMPONENT32F:
+		{
+			return(GL_DEPTH_COMPONENT32F);
+		}
+		break;
+
+		case DEPTH24_STENCIL8:
+		{
+			return(GL_DEPTH24_STENCIL8);
+		}
+		break;
+
+		case DEPTH32F_STENCIL8:
+		{
+			return(GL_DEPTH32F_STENCIL8);
+		}
+		break;
+
+		case STENCIL_INDEX8:
+		{
+			return(GL_STENCIL_INDEX8);
+		}
+		break;
+	}
+
+#pragma GCC diagnostic pop
+
+	return(0);
+}
+
+namespace RenderGraph
+{
+
+/**
+ * @brief Constructor
+ */
+TexturePool::TexturePool(void) : budget(0), allocatedSize(0), idleSize(0), allocations(0), reuses(0), evictions(0)
+{
+	// ...
+}
+
+/**
+ * @brief Destructor (must be called on the thread owning the GL context)
+ */
+TexturePool::~TexturePool(void)
+{
+	evict(0);
+}
+
+/**
+ * @brief Get a texture, an idle one with the same format, size and number of samples is reused when possible
+ * @param format
+ * @param width
+ * @param height
+ * @param samples more than 1 : GL_TEXTURE_2D_MULTISAMPLE texture
+ * @param levels mip levels (single-sample textures only)
+ * @return 0 if the format is not supported
+ */
+unsigned int /*GLuint*/ TexturePool::acquire(TextureFormat format, unsigned int width, unsigned int height, unsigned int samples, unsigned int levels)
+{
+	for (std::list<Entry>::reverse_iterator it = idle.rbegin(); it != idle.rend(); ++it)
+	{
+		if (it->format == format && it->width == width && it->height == height && it->samples == samples && it->levels == levels)
+		{
+			GLuint texture = it->texture;
+
+			idleSize -= GetTextureSize(format, width, height, samples, levels);
+			idle.erase(std::next(it).base());
+
+			++reuses;
+
+			return(texture);
+		}
+	}
+
+	const GLenum internalFormat = GetInternalFormat(format);
+
+	if (internalFormat == 0 || width == 0 || height == 0 || samples == 0 || levels == 0)
+	{
+		return(0);
+	}
+
+	assert(samples == 1 || levels == 1); // multisample textures have no mip chain
+
+	const size_t size = GetTextureSize(format, width, height, samples, levels);
+
+	const size_t maxSize = budget;
+
+	if (maxSize > 0)
+	{
+		evict((maxSize > size) ? (maxSize - size) : 0); // make room first
+	}
+
+	GLuint texture = 0;
+
+	glGenTextures(1, &texture);
+
+	if (samples > 1)
+	{
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+
+		glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, internalFormat, width, height, GL_TRUE);
+
+		assert(glGetError() == GL_NO_ERROR); // samples > GL_MAX_SAMPLES (or the max of this format)
+
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0); // no sampler state
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+
+		assert(glGetError() == GL_NO_ERROR);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (levels > 1) ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST); // textureLod can read every level
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	allocatedSize += size;
+	++allocations;
+
+	return(texture);
+}
+
+/**
+ * @brief Give a texture back to the pool, it is kept idle if it fits in the budget
+ * @param texture
+ * @param format
+ * @param width
+ * @param height
+ * @param samples
+ * @param levels
+ */
+void TexturePool::release(unsigned int /*GLuint*/ texture, TextureFormat format, unsigned int width, unsigned int height, unsigned int samples, unsigned int levels)
+{
+	assert(texture != 0);
+
+	Entry entry;
+	entry.texture = texture;
+	entry.format = format;
+	entry.width = width;
+	entry.height = height;
+	entry.samples = samples;
+	entry.levels = levels;
+
+	idle.push_back(entry);
+	idleSize += GetTextureSize(format, width, height, samples, levels);
+
+	evict(budget);
+}
+
+/**
+ * @brief Set the maximum size of the pool (0, the default, keeps no idle texture)
+ * Idle textures are evicted on the next acquire / release, on the thread owning the GL context
+ * @param maxSize in bytes
+ */
+void TexturePool::setBudget(size_t maxSize)
+{
+	budget = maxSize;
+}
+
+/**
+ * @brief TexturePool::getStatistics
+ * @return
+ */
+TexturePoolStatistics TexturePool::getStatistics(void) const
+{
+	TexturePoolStatistics statistics;
+	statistics.allocations = allocations;
+	statistics.reuses = reuses;
+	statistics.evictions = evictions;
+	statistics.allocatedSize = allocatedSize;
+	statistics.idleSize = idleSize;
+	return(statistics);
+}
+
+/**
+ * @brief Delete idle textures, least recently released first, until the pool is not larger than maxSize (or no texture is idle)
+ * @param maxSize
+ */
+void TexturePool::evict(size_t maxSize)
+{
+	while (allocatedSize > maxSize && !idle.empty())
+	{
+		const Entry & entry = idle.front();
+
+		const size_t size = GetTextureSize(entry.format, entry.width, entry.height, entry.samples, entry.levels);
+
+		glDeleteTextures(1, &entry.texture);
+
+		allocatedSize -= size;
+		idleSize -= size;
+
+		idle.pop_front();
+
+		++evictions;
+	}
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Formats.h"
+
+#include <list>
+#include <atomic>
+
+#include <stddef.h>
+
+namespace RenderGraph
+{
+
+struct TexturePoolStatistics
+{
+	unsigned int allocations;
+	unsigned int reuses;
+	unsigned int evictions;
+	size_t allocatedSize; // textures in use and idle (in bytes)
+	size_t idleSize;
+};
+
+/**
+ * @brief Render target storage shared by the instances of a Factory, keyed by format, dimensions, number of samples and mip levels
+ *
+ * Textures are allocated with immutable storage (glTexStorage2D, or glTexStorage2DMultisample for GL_TEXTURE_2D_MULTISAMPLE textures). A released texture stays idle in the pool until a texture
+ * of the same format and size is needed again, or until it is evicted (least recently released first) to keep the pool in its budget.
+ * Textures in use are never evicted : the budget can be exceeded when an instance needs more than that.
+ *
+ * Must be used on the thread owning the GL context (the budget can be changed from any thread).
+ */
+class TexturePool
+{
+public:
+
+	TexturePool(void);
+	~TexturePool(void);
+
+	unsigned int /*GLuint*/ acquire(TextureFormat format, unsigned int width, unsigned int height, unsigned int samples = 1, unsigned int levels = 1);
+	void release(unsigned int /*GLuint*/ texture, TextureFormat format, unsigned int width, unsigned int height, unsigned int samples = 1, unsigned int levels = 1);
+
+	void setBudget(size_t maxSize);
+
+	TexturePoolStatistics getStatistics(void) const;
+
+private:
+
+	struct Entry
+	{
+		unsigned int /*GLuint*/ texture;
+		TextureFormat format;
+		unsigned int width;
+		unsigned int height;
+		unsigned int samples;
+		unsigned int levels;
+	};
+
+	void evict(size_t maxSize);
+
+	std::list<Entry> idle; // least recently released first
+
+	std::atomic<size_t> budget;
+
+	size_t allocatedSize;
+	size_t idleSize;
+
+	unsigned int allocations;
+	unsigned int reuses;
+	unsigned int evictions;
+};
+
+}
@@ -46,9 +46,73 @@ enum class OpCode : uint8_t
 
 	// Functions
 	CALL,
+
+	// Subgraphs
+	INVOKE,
+	RET,
+
+	// Render pass scopes (consecutive passes rendering into the same attachments)
+	BEGIN,
+	RESUME,
+	DRAW,
+	END,
+
+	// Multisample render targets
+	RESOLVE,
+
 	HALT
 };
 
+/**
+ * @brief Size (in bytes) of the operand following an instruction
+ * @param opcode
+ * @return
+ */
+inline unsigned int getOperandSize(OpCode opcode)
+{
+	switch (opcode)
+	{
+		case OpCode::PUSH:
+		case OpCode::POP:
+		case OpCode::JMP:
+		case OpCode::JMPT:
+		case OpCode::JMPF:
+		case OpCode::CALL:
+		case OpCode::INVOKE:
+		case OpCode::BEGIN:
+		case OpCode::RESUME:
+		case OpCode::DRAW:
+		case OpCode::END:
+		case OpCode::RESOLVE:
+		{
+			return 2; // address
+		}
+
+		case OpCode::ADD:
+		case OpCode::SUB:
+		case OpCode::MUL:
+		case OpCode::DIV:
+		case OpCode::MOD:
+		case OpCode::NEG:
+		case OpCode::ABS:
+		case OpCode::FMA:
+		case OpCode::EQ:
+		case OpCode::NEQ:
+		case OpCode::GT:
+		case OpCode::GTE:
+		case OpCode::LT:
+		case OpCode::LTE:
+		{
+			return 1; // mode
+		}
+
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
 union Value
 {
 	unsigned int	asUInt;
@@ -0,0 +1,89 @@
+#include "Test.h"
+#include "GLStub.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace RenderGraph;
+
+static std::atomic<unsigned int> s_iInitialized(0);
+static std::atomic<unsigned int> s_iDestroyed(0);
+
+/**
+ * @brief Pass taking a while to initialize (e.g. compiling shaders)
+ */
+class SlowPass : public TestPass
+{
+public:
+
+	virtual ~SlowPass(void) override
+	{
+		++s_iDestroyed;
+	}
+
+	virtual bool init(void) override
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		++s_iInitialized;
+		return true;
+	}
+};
+
+/**
+ * @brief Operation factory of SlowPass
+ * @return
+ */
+static Operation * CreateSlowPass(void)
+{
+	return new SlowPass;
+}
+
+/**
+ * @brief Destroying an instance while its operations are queued or initializing in the InitScheduler
+ * The operations are destroyed once their initialization finished, not under the worker threads
+ */
+int main(void)
+{
+	Program program;
+	CreateTestProgram(program);
+
+	for (OperationLayout & operation : program.operations)
+	{
+		operation.subtype = "slow";
+	}
+
+	InitThreadPool scheduler(1); // one worker : the first pass initializes, the second one stays queued
+
+	{
+		Factory factory;
+		CHECK(factory.registerOperation("slow", CreateSlowPass));
+		factory.setInitScheduler(&scheduler);
+
+		Instance * pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+
+		factory.destroyInstance(pInstance);
+		CHECK(s_iDestroyed == s_iInitialized); // nothing destroyed before its initialization finished
+
+		scheduler.wait();
+		CHECK(s_iInitialized == program.operations.size());
+
+		// The retired operations are destroyed by the next update (or by the Factory destructor)
+		pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		factory.updateInstance(pInstance); // no reload : only drains the retired operations
+		CHECK(s_iDestroyed == program.operations.size());
+
+		factory.destroyInstance(pInstance);
+		scheduler.wait();
+	}
+
+	CHECK(s_iDestroyed == 2 * program.operations.size());
+
+	CHECK(GLStub::getTextureCount() == 0);
+	CHECK(GLStub::getFramebufferCount() == 0);
+
+	return(EXIT_SUCCESS);
+}
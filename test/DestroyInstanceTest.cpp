@@ -0,0 +1,72 @@
+#include "Test.h"
+#include "GLStub.h"
+
+using namespace RenderGraph;
+
+/**
+ * @brief Destroying an instance gives its render targets back to the TexturePool, and deletes its framebuffers
+ */
+int main(void)
+{
+	Factory factory;
+	CHECK(factory.registerOperation("test", CreateTestPass));
+
+	Program program;
+	CreateTestProgram(program);
+
+	const size_t allocatedSize = factory.getTexturePoolStatistics().allocatedSize;
+
+	// Budget 0 : the storage is deleted on release
+	{
+		Instance * pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+		CHECK(factory.getTexturePoolStatistics().allocatedSize > allocatedSize);
+		CHECK(GLStub::getFramebufferCount() > 0);
+
+		factory.destroyInstance(pInstance);
+		CHECK(factory.getTexturePoolStatistics().allocatedSize == allocatedSize);
+		CHECK(GLStub::getTextureCount() == 0);
+		CHECK(GLStub::getFramebufferCount() == 0);
+	}
+
+	// Within the budget : the storage stays idle in the pool, and the next instance reuses it
+	factory.setTextureBudget(1 << 20);
+
+	{
+		Instance * pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+
+		const TexturePoolStatistics statistics = factory.getTexturePoolStatistics();
+
+		factory.destroyInstance(pInstance);
+		CHECK(factory.getTexturePoolStatistics().idleSize == statistics.allocatedSize);
+
+		pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+		CHECK(factory.getTexturePoolStatistics().reuses > statistics.reuses);
+		CHECK(factory.getTexturePoolStatistics().allocatedSize == statistics.allocatedSize);
+
+		factory.destroyInstance(pInstance);
+	}
+
+	// Variants sharing render targets (quality tiers) : each resource is released once (and the idle storage evicted with budget 0)
+	factory.setTextureBudget(0);
+
+	{
+		std::vector<Program> programs(2, program);
+
+		Instance * pInstance = factory.createInstanceFromPrograms(programs);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+
+		factory.destroyInstance(pInstance);
+		CHECK(factory.getTexturePoolStatistics().allocatedSize == allocatedSize);
+		CHECK(GLStub::getTextureCount() == 0);
+		CHECK(GLStub::getFramebufferCount() == 0);
+	}
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,76 @@
+#include "Test.h"
+#include "GLStub.h"
+
+#include "Texture.h"
+#include "TexturePool.h"
+#include "Framebuffer.h"
+
+#include "OpenGL.h"
+
+using namespace RenderGraph;
+
+/**
+ * @brief Checks the size of the storage attached to a framebuffer
+ * @param framebuffer
+ * @param width
+ * @param height
+ * @return
+ */
+static bool HasAttachmentSize(const Framebuffer & framebuffer, unsigned int width, unsigned int height)
+{
+	unsigned int attachedWidth = 0;
+	unsigned int attachedHeight = 0;
+
+	if (!GLStub::getAttachmentSize(framebuffer.getNativeHandle(), GL_COLOR_ATTACHMENT0, attachedWidth, attachedHeight))
+	{
+		return(false);
+	}
+
+	return(attachedWidth == width && attachedHeight == height);
+}
+
+/**
+ * @brief Resizing re-attaches the new storage, even when the driver gives it the name of the deleted one (TexturePool with budget 0)
+ */
+int main(void)
+{
+	std::shared_ptr<TexturePool> pool = std::make_shared<TexturePool>();
+	std::shared_ptr<FramebufferCache> cache = std::make_shared<FramebufferCache>();
+
+	TextureLayout layout;
+	layout.format = RGBA8;
+	layout.scale = 1.0f;
+	layout.width = 0;
+	layout.height = 0;
+	layout.samples = 1;
+	layout.levels = 1;
+	layout.resolve = false;
+
+	TestPass pass;
+
+	{
+		Texture texture(layout, pool);
+		Framebuffer framebuffer(std::vector<Texture*>(1, &texture), std::vector<unsigned int>(1, 0), &pass, cache);
+
+		CHECK(texture.resize(64, 64));
+		CHECK(framebuffer.resize());
+		CHECK(HasAttachmentSize(framebuffer, 64, 64));
+
+		const unsigned int /*GLuint*/ handle = texture.getRenderHandle();
+
+		CHECK(texture.resize(128, 128));
+		CHECK(texture.getRenderHandle() == handle); // the case to handle : same name, new storage
+		CHECK(framebuffer.resize());
+		CHECK(framebuffer.getWidth() == 128 && framebuffer.getHeight() == 128);
+		CHECK(HasAttachmentSize(framebuffer, 128, 128));
+
+		CHECK(texture.resize(128, 128)); // same size : same storage
+		CHECK(framebuffer.resize());
+		CHECK(HasAttachmentSize(framebuffer, 128, 128));
+	}
+
+	CHECK(GLStub::getTextureCount() == 0);
+	CHECK(GLStub::getFramebufferCount() == 0);
+
+	return(EXIT_SUCCESS);
+}
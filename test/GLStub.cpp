@@ -0,0 +1,273 @@
+#include "GLStub.h"
+
+#include "OpenGL.h"
+
+#include <map>
+#include <set>
+
+/**
+ * @brief Image of a texture (its storage)
+ */
+struct Image
+{
+	unsigned int width;
+	unsigned int height;
+};
+
+static std::set<GLuint> s_textures;
+static std::set<GLuint> s_framebuffers;
+static std::set<GLuint> s_queries;
+
+static std::map<GLuint, unsigned int> s_textureImages; // texture -> image
+static std::map<unsigned int, Image> s_images;
+static unsigned int s_imageCount = 0;
+
+static std::map<GLuint, std::map<GLenum, unsigned int>> s_attachments; // framebuffer -> attachment -> image
+
+static GLuint s_boundTexture = 0;
+static GLuint s_boundFramebuffer = 0;
+
+/**
+ * @brief Allocate the lowest free names
+ * @param names (in/out)
+ * @param n
+ * @param result
+ */
+static void GenNames(std::set<GLuint> & names, GLsizei n, GLuint * result)
+{
+	GLuint name = 1;
+
+	for (GLsizei i = 0; i < n; ++i)
+	{
+		while (names.find(name) != names.end())
+		{
+			++name;
+		}
+
+		names.insert(name);
+		result[i] = name;
+	}
+}
+
+extern "C"
+{
+
+void glGenTextures(GLsizei n, GLuint * textures)
+{
+	GenNames(s_textures, n, textures);
+}
+
+void glDeleteTextures(GLsizei n, const GLuint * textures)
+{
+	for (GLsizei i = 0; i < n; ++i)
+	{
+		s_textures.erase(textures[i]);
+		s_textureImages.erase(textures[i]);
+	}
+}
+
+void glBindTexture(GLenum, GLuint texture)
+{
+	s_boundTexture = texture;
+}
+
+void glTexStorage2D(GLenum, GLsizei, GLenum, GLsizei width, GLsizei height)
+{
+	Image image;
+	image.width = width;
+	image.height = height;
+
+	s_images[++s_imageCount] = image;
+	s_textureImages[s_boundTexture] = s_imageCount;
+}
+
+void glTexStorage2DMultisample(GLenum target, GLsizei, GLenum internalFormat, GLsizei width, GLsizei height, GLboolean)
+{
+	glTexStorage2D(target, 1, internalFormat, width, height);
+}
+
+void glTexParameteri(GLenum, GLenum, GLint)
+{
+	// ...
+}
+
+void glGenFramebuffers(GLsizei n, GLuint * framebuffers)
+{
+	GenNames(s_framebuffers, n, framebuffers);
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint * framebuffers)
+{
+	for (GLsizei i = 0; i < n; ++i)
+	{
+		s_framebuffers.erase(framebuffers[i]);
+		s_attachments.erase(framebuffers[i]);
+	}
+}
+
+void glBindFramebuffer(GLenum, GLuint framebuffer)
+{
+	s_boundFramebuffer = framebuffer;
+}
+
+void glFramebufferTexture2D(GLenum, GLenum attachment, GLenum, GLuint texture, GLint)
+{
+	std::map<GLuint, unsigned int>::const_iterator it = s_textureImages.find(texture);
+
+	s_attachments[s_boundFramebuffer][attachment] = (it != s_textureImages.end()) ? it->second : 0;
+}
+
+GLenum glCheckFramebufferStatus(GLenum)
+{
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void glDrawBuffers(GLsizei, const GLenum *)
+{
+	// ...
+}
+
+void glBlitFramebuffer(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum)
+{
+	// ...
+}
+
+void glGetIntegerv(GLenum, GLint * data)
+{
+	*data = 8; // GL_MAX_DRAW_BUFFERS, GL_MAX_COLOR_ATTACHMENTS
+}
+
+GLenum glGetError(void)
+{
+	return GL_NO_ERROR;
+}
+
+void glViewport(GLint, GLint, GLsizei, GLsizei)
+{
+	// ...
+}
+
+void glColorMask(GLboolean, GLboolean, GLboolean, GLboolean)
+{
+	// ...
+}
+
+void glDepthMask(GLboolean)
+{
+	// ...
+}
+
+void glStencilMask(GLuint)
+{
+	// ...
+}
+
+void glClearColor(GLfloat, GLfloat, GLfloat, GLfloat)
+{
+	// ...
+}
+
+void glClearDepthf(GLfloat)
+{
+	// ...
+}
+
+void glClearStencil(GLint)
+{
+	// ...
+}
+
+void glClear(GLbitfield)
+{
+	// ...
+}
+
+void glGenQueries(GLsizei n, GLuint * ids)
+{
+	GenNames(s_queries, n, ids);
+}
+
+void glDeleteQueries(GLsizei n, const GLuint * ids)
+{
+	for (GLsizei i = 0; i < n; ++i)
+	{
+		s_queries.erase(ids[i]);
+	}
+}
+
+void glBeginQuery(GLenum, GLuint)
+{
+	// ...
+}
+
+void glEndQuery(GLenum)
+{
+	// ...
+}
+
+void glGetQueryObjectuiv(GLuint, GLenum, GLuint * params)
+{
+	*params = GL_TRUE;
+}
+
+void glGetQueryObjectui64v(GLuint, GLenum, GLuint64 * params)
+{
+	*params = 0;
+}
+
+}
+
+namespace GLStub
+{
+
+/**
+ * @brief Number of textures not deleted
+ * @return
+ */
+unsigned int getTextureCount(void)
+{
+	return s_textures.size();
+}
+
+/**
+ * @brief Number of framebuffers not deleted
+ * @return
+ */
+unsigned int getFramebufferCount(void)
+{
+	return s_framebuffers.size();
+}
+
+/**
+ * @brief Size of the image attached to a framebuffer
+ * @param framebuffer
+ * @param attachment
+ * @param width
+ * @param height
+ * @return false if nothing is attached
+ */
+bool getAttachmentSize(unsigned int framebuffer, unsigned int attachment, unsigned int & width, unsigned int & height)
+{
+	std::map<GLuint, std::map<GLenum, unsigned int>>::const_iterator it = s_attachments.find(framebuffer);
+
+	if (it == s_attachments.end())
+	{
+		return false;
+	}
+
+	std::map<GLenum, unsigned int>::const_iterator itImage = it->second.find(attachment);
+
+	if (itImage == it->second.end() || itImage->second == 0)
+	{
+		return false;
+	}
+
+	const Image & image = s_images[itImage->second];
+
+	width = image.width;
+	height = image.height;
+
+	return true;
+}
+
+}
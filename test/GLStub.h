@@ -0,0 +1,17 @@
+#pragma once
+
+/**
+ * @brief OpenGL functions used by the library, implemented without a context
+ *
+ * Names of deleted objects are handed out again (lowest free name first), like most drivers do.
+ * Each glTexStorage2D creates a new image : a framebuffer keeps the image it was attached to, even if the texture name is reused.
+ */
+namespace GLStub
+{
+
+unsigned int getTextureCount(void);
+unsigned int getFramebufferCount(void);
+
+bool getAttachmentSize(unsigned int framebuffer, unsigned int attachment, unsigned int & width, unsigned int & height);
+
+}
@@ -0,0 +1,95 @@
+#include "Test.h"
+
+using namespace RenderGraph;
+
+/**
+ * @brief Serialize a program and read it back
+ * @param program
+ * @return false if the program read is rejected
+ */
+static bool Reload(const Program & program)
+{
+	std::vector<uint8_t> buffer;
+
+	if (!program.serialize(buffer))
+	{
+		return(false);
+	}
+
+	Program loaded;
+	return(loaded.deserialize(buffer.data(), buffer.size()));
+}
+
+/**
+ * @brief A program with an index out of range is rejected when it is read (corrupted cache file)
+ */
+int main(void)
+{
+	Program program;
+	CreateTestProgram(program);
+
+	program.values.resize(2);
+	program.valueSlots["value"] = std::vector<unsigned int>(1, 1);
+
+	CHECK(Reload(program));
+
+	{
+		Program corrupted = program;
+		corrupted.framebuffers[0].textures[0] = corrupted.textures.size();
+		CHECK(!Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+		corrupted.framebuffers[1].operation = corrupted.operations.size();
+		CHECK(!Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+		corrupted.presents[0].operations[0] = corrupted.operations.size();
+		CHECK(!Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+		corrupted.presents[0].framebuffer = corrupted.framebuffers.size();
+		CHECK(!Reload(corrupted));
+
+		corrupted.useDefaultFramebuffer = true; // no framebuffer to check
+		CHECK(Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+
+		InvocationLayout invocation;
+		invocation.entry = 0;
+		invocation.values = corrupted.values.size();
+		invocation.textures = corrupted.textures.size();
+		invocation.operations = corrupted.operations.size();
+		corrupted.invocations.push_back(invocation);
+		CHECK(Reload(corrupted)); // subgraph without resources
+
+		corrupted.invocations[0].entry = corrupted.bytecode.size();
+		CHECK(!Reload(corrupted));
+
+		corrupted.invocations[0].entry = 0;
+		corrupted.invocations[0].textures = corrupted.textures.size() + 1;
+		CHECK(!Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+		corrupted.textureSlots["texture0"] = corrupted.textures.size();
+		CHECK(!Reload(corrupted));
+	}
+
+	{
+		Program corrupted = program;
+		corrupted.valueSlots["value"][0] = corrupted.values.size();
+		CHECK(!Reload(corrupted));
+	}
+
+	return(EXIT_SUCCESS);
+}
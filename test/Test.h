@@ -0,0 +1,82 @@
+#pragma once
+
+#include "RenderGraph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition) \
+if (!(condition)) \
+{ \
+	fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+	return(EXIT_FAILURE); \
+}
+
+/**
+ * @brief Pass rendering nothing
+ */
+class TestPass : public RenderGraph::Pass
+{
+public:
+
+	virtual bool render(RenderGraph::Parameters & /*parameters*/) override
+	{
+		return true;
+	}
+};
+
+/**
+ * @brief Operation factory of TestPass
+ * @return
+ */
+static inline RenderGraph::Operation * CreateTestPass(void)
+{
+	return new TestPass;
+}
+
+/**
+ * @brief Program rendering a texture in a first pass, read by a second pass rendering the output
+ * @param program (output)
+ */
+static inline void CreateTestProgram(RenderGraph::Program & program)
+{
+	using namespace RenderGraph;
+
+	program.clear();
+
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		TextureLayout texture;
+		texture.format = RGBA8;
+		texture.scale = 1.0f;
+		texture.width = 0;
+		texture.height = 0;
+		texture.samples = 1;
+		texture.levels = 1;
+		texture.resolve = false;
+		program.textures.push_back(texture);
+
+		OperationLayout operation;
+		operation.id = "pass" + std::to_string(i);
+		operation.subtype = "test";
+		operation.inputs = 0;
+		operation.outputs = 0;
+		program.operations.push_back(operation);
+
+		FramebufferLayout framebuffer;
+		framebuffer.textures.push_back(i);
+		framebuffer.levels.push_back(0);
+		framebuffer.operation = i;
+		program.framebuffers.push_back(framebuffer);
+
+		program.textureSlots["texture" + std::to_string(i)] = i;
+	}
+
+	PresentLayout present;
+	present.name = "output";
+	present.operations.push_back(1);
+	present.framebuffer = 1;
+	program.presents.push_back(present);
+
+	program.bytecode.push_back(uint8_t(OpCode::HALT));
+}
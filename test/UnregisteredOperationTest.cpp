@@ -0,0 +1,44 @@
+#include "Test.h"
+#include "GLStub.h"
+
+using namespace RenderGraph;
+
+/**
+ * @brief Operations of a type that is not registered are left out (nullptr) : the instance can still be resized and scaled
+ */
+int main(void)
+{
+	Factory factory; // "test" not registered
+
+	Program program;
+	CreateTestProgram(program);
+
+	// Own framebuffers
+	{
+		Instance * pInstance = factory.createInstanceFromProgram(program);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+		CHECK(pInstance->setRenderScale(0.5f));
+		pInstance->execute();
+
+		factory.destroyInstance(pInstance);
+	}
+
+	// Outputs rendered into the framebuffer of the application
+	{
+		program.useDefaultFramebuffer = true;
+
+		Instance * pInstance = factory.createInstanceFromProgram(program, 0);
+		CHECK(pInstance != nullptr);
+		CHECK(pInstance->resize(64, 64));
+		CHECK(pInstance->setRenderScale(0.5f));
+		pInstance->execute();
+
+		factory.destroyInstance(pInstance);
+	}
+
+	CHECK(GLStub::getTextureCount() == 0);
+	CHECK(GLStub::getFramebufferCount() == 0);
+
+	return(EXIT_SUCCESS);
+}